@@ -0,0 +1,131 @@
+#include "batch.h"
+#include <chrono>
+#include <dirent.h>
+
+////////////////////////////////////////////////////////////////////////////////
+/// BatchSolver
+////////////////////////////////////////////////////////////////////////////////
+
+BatchSolver::BatchSolver(const Optimizer & prototype, WorkerPool & pool) :
+        polishNeighbors(0),
+        pool(pool)
+{
+    for (int i = 0; i < pool.size(); i++)
+    {
+        workers.push_back(new Worker(prototype));
+    }
+}
+
+BatchSolver::~BatchSolver()
+{
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        DELETE_PTR(workers[i]);
+    }
+}
+
+void BatchSolver::solve(const std::vector<std::string> & files, std::ostream & out)
+{
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        const std::string file = files[i];
+        pool.submit([this, file, &out](int worker) {
+            solveOne(file, worker, out);
+        });
+    }
+    pool.wait();
+}
+
+void BatchSolver::solveOne(const std::string & file, int worker, std::ostream & out)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Worker & w = *workers[worker];
+
+    // Load the instance into the buffers of this worker
+    std::stringstream line;
+    w.instance.clear();
+    std::ifstream stream(file.c_str(), std::ios::binary);
+    if (!stream.is_open())
+    {
+        line << file << "\terror\tCannot open data file." << std::endl;
+    }
+    else if (!w.instance.read(stream))
+    {
+        line << file << "\terror\tInvalid instance file." << std::endl;
+    }
+    else if (w.instance.getCities().size() < 3)
+    {
+        line << file << "\terror\tToo few cities." << std::endl;
+    }
+    else
+    {
+        w.instance.calcDistanceMatrix();
+
+        w.optimizer.localSearch = 0;
+        if (polishNeighbors > 0)
+        {
+            w.neighbors.build(w.instance, polishNeighbors);
+            w.optimizer.localSearch = &w.search;
+        }
+        w.optimizer.optimize(w.instance, w.tour);
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        line << file << "\t" << w.tour.size() << "\t" << w.instance.calcTourLength(w.tour) << "\t" << seconds << "\t";
+        for (size_t i = 0; i < w.tour.size(); i++)
+        {
+            line << (i > 0 ? " " : "") << w.tour[i];
+        }
+        line << std::endl;
+    }
+
+    // Stream the result
+    std::lock_guard<std::mutex> lock(outputMutex);
+    out << line.str();
+    out.flush();
+}
+
+bool BatchSolver::listInstances(const std::string & path, std::vector<std::string> & files)
+{
+    // Is this a directory?
+    DIR* dir = opendir(path.c_str());
+    if (dir != 0)
+    {
+        // TSPLIB files and binary coordinate files
+        const char* const suffixes[] = {".tsp", ".bin"};
+        std::vector<std::string> found;
+        for (struct dirent* entry = readdir(dir); entry != 0; entry = readdir(dir))
+        {
+            const std::string name = entry->d_name;
+            for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++)
+            {
+                const std::string suffix = suffixes[i];
+                if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+                {
+                    found.push_back(path + "/" + name);
+                    break;
+                }
+            }
+        }
+        closedir(dir);
+
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+        return true;
+    }
+
+    // It is a list of files
+    std::ifstream stream(path.c_str());
+    if (!stream.is_open())
+    {
+        return false;
+    }
+    std::string file;
+    while (std::getline(stream, file))
+    {
+        if (!file.empty())
+        {
+            files.push_back(file);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,108 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "tsp.h"
+#include "parallel.h"
+#include "localsearch.h"
+#include "pool.h"
+
+/**
+ * This class solves many TSPLIB instances on a pool of worker threads. Every
+ * worker keeps its instance, distance matrix, neighbor lists and tour buffers
+ * between jobs. A result line is written as soon as a job finishes.
+ */
+class BatchSolver {
+public:
+    /**
+     * Constructor. Every worker copies the parameters and moves of the
+     * prototype.
+     */
+    BatchSolver(const Optimizer & prototype, WorkerPool & pool);
+
+    /**
+     * Destructor
+     */
+    ~BatchSolver();
+
+    /**
+     * The number of neighbors for the local search polish. Set to 0 in order
+     * to disable the polish
+     */
+    int polishNeighbors;
+
+    /**
+     * Solves all instances. For every instance, a tab separated line
+     * "file cities length seconds tour" or "file error message" is written
+     * to the output stream. The lines appear in the order in which the jobs
+     * finish.
+     */
+    void solve(const std::vector<std::string> & files, std::ostream & out);
+
+    /**
+     * Lists the instances of a batch. If the path is a directory, then all
+     * .tsp and .bin files in the directory are returned. Otherwise, the path names a
+     * file that lists one instance per line. Returns false if the path cannot
+     * be read.
+     */
+    static bool listInstances(const std::string & path, std::vector<std::string> & files);
+
+private:
+    BatchSolver(const BatchSolver &);
+    BatchSolver & operator=(const BatchSolver &);
+
+    /**
+     * The buffers of a single worker
+     */
+    class Worker {
+    public:
+        /**
+         * Constructor
+         */
+        Worker(const Optimizer & prototype) : optimizer(prototype, false), search(neighbors) {}
+
+        /**
+         * The current instance
+         */
+        TSPInstance instance;
+        /**
+         * The private optimizer
+         */
+        OptimizerClone optimizer;
+        /**
+         * The neighbor lists of the current instance
+         */
+        NeighborLists neighbors;
+        /**
+         * The local search
+         */
+        TwoOptOrOptSearch search;
+        /**
+         * The result tour
+         */
+        std::vector<int> tour;
+    };
+
+    /**
+     * Solves a single instance on a worker
+     */
+    void solveOne(const std::string & file, int worker, std::ostream & out);
+
+    /**
+     * The worker pool
+     */
+    WorkerPool & pool;
+    /**
+     * The buffers of every worker
+     */
+    std::vector<Worker*> workers;
+    /**
+     * Serializes the output
+     */
+    std::mutex outputMutex;
+};
+
+#endif
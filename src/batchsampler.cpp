@@ -0,0 +1,108 @@
+#include "batchsampler.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+/// 2-opt evaluation
+////////////////////////////////////////////////////////////////////////////////
+
+void evaluate2opt(const TSPInstance & instance, const int* a, const int* b, const int* c, const int* d, float* delta, int count)
+{
+    const float* dist = instance.getDistanceData();
+    const int stride = instance.getDistanceStride();
+
+    int k = 0;
+#ifdef __AVX2__
+    // Gather 8 moves at once. The gather indices are 32 bit integers
+    if (static_cast<long long>(stride) * stride < (1LL << 31))
+    {
+        const __m256i s = _mm256_set1_epi32(stride);
+        for (; k + 8 <= count; k += 8)
+        {
+            const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + k));
+            const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + k));
+            const __m256i vc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c + k));
+            const __m256i vd = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(d + k));
+
+            const __m256 ac = _mm256_i32gather_ps(dist, _mm256_add_epi32(va, _mm256_mullo_epi32(vc, s)), 4);
+            const __m256 bd = _mm256_i32gather_ps(dist, _mm256_add_epi32(vb, _mm256_mullo_epi32(vd, s)), 4);
+            const __m256 ab = _mm256_i32gather_ps(dist, _mm256_add_epi32(va, _mm256_mullo_epi32(vb, s)), 4);
+            const __m256 cd = _mm256_i32gather_ps(dist, _mm256_add_epi32(vc, _mm256_mullo_epi32(vd, s)), 4);
+
+            _mm256_storeu_ps(delta + k, _mm256_sub_ps(_mm256_add_ps(ac, bd), _mm256_add_ps(ab, cd)));
+        }
+    }
+#endif
+    const size_t st = static_cast<size_t>(stride);
+    for (; k < count; k++)
+    {
+        delta[k] = (dist[a[k] + c[k] * st] + dist[b[k] + d[k] * st])
+                 - (dist[a[k] + b[k] * st] + dist[c[k] + d[k] * st]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// BatchSampler
+////////////////////////////////////////////////////////////////////////////////
+
+BatchSampler::BatchSampler(const TSPInstance & instance, int batchSize, unsigned int seed) :
+        instance(instance),
+        batchSize(batchSize),
+        generator(seed),
+        first(batchSize), last(batchSize),
+        a(batchSize), b(batchSize), c(batchSize), d(batchSize),
+        delta(batchSize)
+{
+    assert(batchSize > 0);
+}
+
+int BatchSampler::step(std::vector<int> & state, float & energy, float temp, int maxProposals, bool & accepted)
+{
+    const int n = static_cast<int>(state.size());
+    assert(n >= 3);
+    const int count = std::min(batchSize, maxProposals);
+
+    // Sample a batch of chain reversals. As for the other moves, the first
+    // city stays in place
+    std::uniform_int_distribution<int> positionDist(1, n - 1);
+    for (int k = 0; k < count; k++)
+    {
+        int i = positionDist(generator);
+        int j = positionDist(generator);
+        while (j == i)
+        {
+            j = positionDist(generator);
+        }
+        if (i > j)
+        {
+            std::swap(i, j);
+        }
+        first[k] = i;
+        last[k] = j;
+        a[k] = state[i - 1];
+        b[k] = state[i];
+        c[k] = state[j];
+        d[k] = state[j + 1 == n ? 0 : j + 1];
+    }
+
+    evaluate2opt(instance, &a[0], &b[0], &c[0], &d[0], &delta[0], count);
+
+    // Find the first accepted proposal
+    std::uniform_real_distribution<float> uniformDist(0.0f, 1.0f);
+    for (int k = 0; k < count; k++)
+    {
+        if (delta[k] <= 0 || uniformDist(generator) <= std::exp(-delta[k] / temp))
+        {
+            std::reverse(state.begin() + first[k], state.begin() + last[k] + 1);
+            energy += delta[k];
+            accepted = true;
+            return k + 1;
+        }
+    }
+
+    // The whole batch has been rejected
+    accepted = false;
+    return count;
+}
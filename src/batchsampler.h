@@ -0,0 +1,69 @@
+#ifndef BATCHSAMPLER_H
+#define BATCHSAMPLER_H
+
+#include <random>
+#include <vector>
+
+#include "tsp.h"
+
+/**
+ * This class speeds up the Metropolis chain at low temperatures where almost
+ * every proposal is rejected. A rejected proposal does not change the state.
+ * Hence, a batch of independent proposals can be evaluated against the same
+ * state at once, and the first accepted proposal of the batch is exactly the
+ * move the sequential chain would have made. All proposals before it count as
+ * rejections.
+ *
+ * The proposals are random 2-opt moves whose energy deltas are evaluated in
+ * O(1) each using SIMD gathers from the distance matrix, instead of copying
+ * the state and recomputing the tour length for every proposal.
+ */
+class BatchSampler {
+public:
+    /**
+     * Constructor
+     */
+    BatchSampler(const TSPInstance & instance, int batchSize, unsigned int seed);
+
+    /**
+     * Advances the chain until the first accepted proposal of the next batch.
+     * The energy is updated incrementally. Returns the number of proposals
+     * that have been simulated, which is at most maxProposals. Whether or not
+     * a proposal has been accepted is stored in accepted.
+     */
+    int step(std::vector<int> & state, float & energy, float temp, int maxProposals, bool & accepted);
+
+private:
+    /**
+     * The instance
+     */
+    const TSPInstance & instance;
+    /**
+     * The number of proposals per batch
+     */
+    int batchSize;
+    /**
+     * The random number generator
+     */
+    std::mt19937 generator;
+    /**
+     * The chain boundaries of the proposals
+     */
+    std::vector<int> first, last;
+    /**
+     * The cities at the four endpoints of every proposal
+     */
+    std::vector<int> a, b, c, d;
+    /**
+     * The energy deltas of the proposals
+     */
+    std::vector<float> delta;
+};
+
+/**
+ * Evaluates the deltas of count 2-opt moves that remove the edges (a,b) and
+ * (c,d) and add the edges (a,c) and (b,d)
+ */
+void evaluate2opt(const TSPInstance & instance, const int* a, const int* b, const int* c, const int* d, float* delta, int count);
+
+#endif
@@ -0,0 +1,642 @@
+#include "tsp.h"
+#include "parallel.h"
+#include "population.h"
+#include "localsearch.h"
+#include "incremental.h"
+#include "generator.h"
+#include "replica.h"
+#include "trace.h"
+#include "tuner.h"
+#include "multilevel.h"
+#include "batch.h"
+#include "daemon.h"
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Returns the seconds elapsed since start
+ */
+static double secondsSince(const std::chrono::steady_clock::time_point & start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Compares cooperative chains against independent multi-start at the same
+ * number of cores
+ */
+static void benchCooperative(const TSPInstance & instance, int repetitions)
+{
+    ParameterizedOptimizer optimizer((AnnealingParameters()));
+    optimizer.notificationCycle = 1000;
+
+    GapMigrationPolicy policy(5, 0.02f);
+
+    CooperativeOptimizer independent(optimizer);
+    CooperativeOptimizer cooperative(optimizer);
+    cooperative.migrationPolicy = &policy;
+
+    std::cout << "cooperative annealing (" << independent.numChains << " chains, "
+              << repetitions << " runs)" << std::endl;
+
+    const CooperativeOptimizer* variants[] = {&independent, &cooperative};
+    const char* names[] = {"independent", "cooperative"};
+    for (int v = 0; v < 2; v++)
+    {
+        double energy = 0;
+        double seconds = 0;
+        for (int r = 0; r < repetitions; r++)
+        {
+            std::vector<int> result;
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            variants[v]->optimize(instance, result);
+            seconds += secondsSince(start);
+            energy += instance.calcTourLength(result);
+        }
+        std::cout << "  " << std::setw(12) << std::left << names[v]
+                  << " mean length = " << std::setw(10) << energy/repetitions
+                  << " mean time = " << seconds/repetitions << "s" << std::endl;
+    }
+}
+
+/**
+ * Measures how much the local search improves the annealing result and how
+ * long it takes
+ */
+static void benchLocalSearch(const TSPInstance & instance)
+{
+    ParameterizedOptimizer optimizer((AnnealingParameters()));
+    optimizer.notificationCycle = 1000;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    NeighborLists neighbors;
+    neighbors.build(instance, 8);
+    const double listSeconds = secondsSince(start);
+
+    std::vector<int> result;
+    optimizer.optimize(instance, result);
+    const float annealed = instance.calcTourLength(result);
+
+    TwoOptOrOptSearch localSearch(neighbors);
+    start = std::chrono::steady_clock::now();
+    const float polished = localSearch.improve(instance, result);
+    const double searchSeconds = secondsSince(start);
+
+    std::cout << "local search polish" << std::endl;
+    std::cout << "  neighbor lists   time = " << listSeconds << "s" << std::endl;
+    std::cout << "  annealed         length = " << annealed << std::endl;
+    std::cout << "  polished         length = " << polished
+              << " time = " << searchSeconds << "s" << std::endl;
+}
+
+/**
+ * Compares incremental updates against a full re-solve, i.e. the distance
+ * matrix setup and a cold annealing run with local search polish
+ */
+static void benchIncremental(int n, int updates)
+{
+    TSPInstance instance;
+    instance.createRandom(n);
+    instance.calcDistanceMatrix();
+
+    // Start from a locally optimal tour
+    NeighborLists neighbors;
+    neighbors.build(instance, 8);
+    TwoOptOrOptSearch localSearch(neighbors);
+    std::vector<int> tour(n);
+    for (int i = 0; i < n; i++)
+    {
+        tour[i] = i;
+    }
+    localSearch.improve(instance, tour);
+
+    IncrementalSolver solver(instance, tour);
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> coordDist(0.0f, 999.0f);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int u = 0; u < updates; u++)
+    {
+        solver.insertCity(std::make_pair(coordDist(generator), coordDist(generator)));
+        std::uniform_int_distribution<int> cityDist(0, static_cast<int>(tour.size()) - 1);
+        solver.removeCity(cityDist(generator));
+    }
+    const double incrementalSeconds = secondsSince(start) / (2 * updates);
+
+    // A full re-solve of the final instance
+    ParameterizedOptimizer optimizer((AnnealingParameters()));
+    std::vector<int> fresh;
+    optimizer.localSearch = &localSearch;
+    start = std::chrono::steady_clock::now();
+    instance.calcDistanceMatrix();
+    neighbors.build(instance, 8);
+    optimizer.optimize(instance, fresh);
+    const double fullSeconds = secondsSince(start);
+    const float freshLength = instance.calcTourLength(fresh);
+
+    std::cout << "incremental updates (" << n << " cities, " << 2 * updates << " updates)" << std::endl;
+    std::cout << "  incremental      length = " << solver.getLength()
+              << " time per update = " << incrementalSeconds * 1000 << "ms" << std::endl;
+    std::cout << "  full re-solve    length = " << freshLength
+              << " time = " << fullSeconds * 1000 << "ms" << std::endl;
+}
+
+/**
+ * Compares the plain Metropolis loop against batched cold levels
+ */
+static void benchBatchedLevels(const TSPInstance & instance)
+{
+    ParameterizedOptimizer optimizer((AnnealingParameters()));
+    optimizer.notificationCycle = 1000;
+
+    std::cout << "batched cold levels" << std::endl;
+    for (int v = 0; v < 2; v++)
+    {
+        optimizer.batchSize = v == 0 ? 0 : 64;
+
+        std::vector<int> result;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        optimizer.optimize(instance, result);
+        const double seconds = secondsSince(start);
+
+        std::cout << "  " << std::setw(12) << std::left << (v == 0 ? "metropolis" : "batched")
+                  << " length = " << std::setw(10) << instance.calcTourLength(result)
+                  << " time = " << std::setw(10) << seconds << "s"
+                  << " iterations/s = " << optimizer.outerLoops * static_cast<double>(optimizer.innerLoops) / seconds
+                  << std::endl;
+    }
+}
+
+/**
+ * Compares partition crossover between chains against independent restarts 
+ * at the same number of cores
+ */
+static void benchPopulation(const TSPInstance & instance, int repetitions)
+{
+    ParameterizedOptimizer optimizer((AnnealingParameters()));
+    optimizer.notificationCycle = 1000;
+    optimizer.batchSize = 64;
+
+    CooperativeOptimizer independent(optimizer);
+    PartitionCrossover crossover;
+    PopulationOptimizer population(optimizer, crossover);
+    population.numChains = independent.numChains;
+
+    std::cout << "population with partition crossover (" << population.numChains << " chains, "
+              << repetitions << " runs)" << std::endl;
+
+    for (int v = 0; v < 2; v++)
+    {
+        double energy = 0;
+        double seconds = 0;
+        for (int r = 0; r < repetitions; r++)
+        {
+            std::vector<int> result;
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            if (v == 0)
+            {
+                independent.optimize(instance, result);
+            }
+            else
+            {
+                population.optimize(instance, result);
+            }
+            seconds += secondsSince(start);
+            energy += instance.calcTourLength(result);
+        }
+        std::cout << "  " << std::setw(12) << std::left << (v == 0 ? "independent" : "population")
+                  << " mean length = " << std::setw(10) << energy/repetitions
+                  << " mean time = " << seconds/repetitions << "s" << std::endl;
+    }
+}
+
+/**
+ * Measures the generator throughput and how the hot paths of the solver scale
+ * with the number of cities and their distribution
+ */
+static void benchScaling()
+{
+    WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    InstanceGenerator generator(pool);
+    const char* names[] = {"uniform", "clustered", "grid"};
+
+    std::cout << "synthetic instances (" << pool.size() << " workers)" << std::endl;
+    for (int d = 0; d < 3; d++)
+    {
+        InstanceGenerator::parseDistribution(names[d], generator.distribution);
+
+        std::vector<City> cities;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        generator.generate(1000000, cities);
+        std::cout << "  " << std::setw(12) << std::left << names[d]
+                  << " 1M cities time = " << secondsSince(start) << "s" << std::endl;
+
+        const int sizes[] = {1000, 2000, 4000};
+        for (int s = 0; s < 3; s++)
+        {
+            TSPInstance instance;
+            generator.generate(sizes[s], cities);
+            instance.swapCities(cities);
+
+            std::chrono::steady_clock::time_point step = std::chrono::steady_clock::now();
+            instance.calcDistanceMatrix(pool);
+            const double matrixSeconds = secondsSince(step);
+
+            step = std::chrono::steady_clock::now();
+            NeighborLists neighbors;
+            neighbors.build(instance, 8);
+            const double listSeconds = secondsSince(step);
+
+            std::vector<int> tour(sizes[s]);
+            for (int i = 0; i < sizes[s]; i++)
+            {
+                tour[i] = i;
+            }
+            TwoOptOrOptSearch localSearch(neighbors);
+            step = std::chrono::steady_clock::now();
+            localSearch.improve(instance, tour);
+            const double searchSeconds = secondsSince(step);
+
+            std::cout << "    n = " << std::setw(6) << sizes[s]
+                      << " matrix = " << std::setw(10) << matrixSeconds << "s"
+                      << " neighbors = " << std::setw(10) << listSeconds << "s"
+                      << " local search = " << searchSeconds << "s" << std::endl;
+        }
+    }
+}
+
+/**
+ * Compares the tiled distance matrix setup, with a single thread and with a 
+ * worker pool, against the plain loop over all pairs
+ */
+static void benchDistanceMatrix(int n)
+{
+    TSPInstance instance;
+    instance.createRandom(n);
+    const std::vector<City> & cities = instance.getCities();
+
+    // Touch the memory of both matrices first, such that page faults are 
+    // not measured
+    Matrix<float> reference(n, n);
+    reference = 0.0f;
+    instance.calcDistanceMatrix();
+
+    // The plain loop computes every pair twice and writes every row with a 
+    // stride of n
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = i; j < n; j++)
+        {
+            reference(i,j) = instance.dist(cities[i], cities[j]);
+            reference(j,i) = instance.dist(cities[i], cities[j]);
+        }
+    }
+    const double plainSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    instance.calcDistanceMatrix();
+    const double tiledSeconds = secondsSince(start);
+
+    WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    start = std::chrono::steady_clock::now();
+    instance.calcDistanceMatrix(pool);
+    const double pooledSeconds = secondsSince(start);
+
+    float deviation = 0;
+    for (int j = 0; j < n; j++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            deviation = std::max(deviation, std::abs(instance.dist(i, j) - reference(i,j)));
+        }
+    }
+
+    std::cout << "distance matrix (" << n << " cities)" << std::endl;
+    std::cout << "  plain loop       time = " << plainSeconds << "s" << std::endl;
+    std::cout << "  tiled            time = " << tiledSeconds << "s"
+              << " speedup = " << plainSeconds / tiledSeconds << std::endl;
+    std::cout << "  tiled, " << std::setw(2) << pool.size() << " workers time = " << pooledSeconds << "s"
+              << " speedup = " << plainSeconds / pooledSeconds
+              << " max deviation = " << deviation << std::endl;
+}
+
+/**
+ * Measures the size and speed of the binary tour encoding that is used in 
+ * order to exchange tours between processes
+ */
+static void benchTourEncoding()
+{
+    WorkerPool pool(1);
+    InstanceGenerator generator(pool);
+    const char* names[] = {"uniform", "clustered", "grid"};
+    const int n = 100000;
+
+    std::cout << "tour encoding (" << n << " cities, strip tours)" << std::endl;
+    for (int d = 0; d < 3; d++)
+    {
+        InstanceGenerator::parseDistribution(names[d], generator.distribution);
+        std::vector<City> cities;
+        generator.generate(n, cities);
+        TSPInstance instance;
+        instance.swapCities(cities);
+
+        // Visiting the cities from left to right stands in for a good tour.
+        // The distance matrix would not fit into memory
+        std::vector<int> tour(n);
+        for (int i = 0; i < n; i++)
+        {
+            tour[i] = i;
+        }
+        std::sort(tour.begin(), tour.end(), [&instance](int a, int b) {
+            return instance.getCities()[a].first < instance.getCities()[b].first;
+        });
+
+        std::string data;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        encodeTour(tour, data);
+        const double encodeSeconds = secondsSince(start);
+
+        std::vector<int> decoded;
+        size_t offset = 0;
+        start = std::chrono::steady_clock::now();
+        const bool success = decodeTour(data, offset, n, decoded) && decoded == tour;
+        const double decodeSeconds = secondsSince(start);
+
+        std::cout << "  " << std::setw(12) << std::left << names[d]
+                  << " bytes per city = " << std::setw(10) << static_cast<double>(data.size()) / n
+                  << " encode = " << std::setw(10) << encodeSeconds * 1000 << "ms"
+                  << " decode = " << decodeSeconds * 1000 << "ms"
+                  << (success ? "" : " (mismatch)") << std::endl;
+    }
+}
+
+/**
+ * Measures the overhead of tracing every temperature level and a sample of 
+ * the iterations
+ */
+static void benchTracing(const TSPInstance & instance, int repetitions)
+{
+    ParameterizedOptimizer optimizer((AnnealingParameters()));
+    optimizer.notificationCycle = 1000;
+
+    const char* path = "sa-bench.trace";
+    TraceRecorder tracer;
+    if (!tracer.open(path))
+    {
+        std::cout << "Cannot open trace file." << std::endl;
+        return;
+    }
+
+    // Alternate between both variants such that they see the same machine
+    // state
+    double seconds[2] = {0, 0};
+    for (int r = 0; r < repetitions; r++)
+    {
+        for (int v = 0; v < 2; v++)
+        {
+            optimizer.tracer = v == 0 ? 0 : &tracer;
+            std::vector<int> result;
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            optimizer.optimize(instance, result);
+            seconds[v] += secondsSince(start);
+        }
+    }
+
+    std::cout << "tracing (sample interval " << tracer.sampleInterval << ", " << repetitions << " runs)" << std::endl;
+    std::cout << "  untraced         mean time = " << seconds[0]/repetitions << "s" << std::endl;
+    std::cout << "  traced           mean time = " << seconds[1]/repetitions << "s"
+              << " overhead = " << 100 * (seconds[1] - seconds[0]) / seconds[0] << "%"
+              << " dropped = " << tracer.getDropped() << std::endl;
+    std::remove(path);
+}
+
+/**
+ * Compares the multilevel solver against flat annealing that gets ten times
+ * the time of the multilevel solver
+ */
+static void benchMultilevel(int n)
+{
+    WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    InstanceGenerator generator(pool);
+    generator.distribution = InstanceGenerator::CLUSTERED;
+    std::vector<City> cities;
+    generator.generate(n, cities);
+    TSPInstance instance;
+    instance.swapCities(cities);
+
+    AnnealingParameters parameters;
+    ParameterizedOptimizer optimizer(parameters);
+    optimizer.seed = 1;
+    MultilevelSolver solver(optimizer, pool);
+    solver.seed = 1;
+    std::vector<int> tour;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const double multilevelLength = solver.solve(instance, tour);
+    const double multilevelSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    instance.calcDistanceMatrix(pool);
+    optimizer.timeLimit = static_cast<float>(10 * multilevelSeconds);
+    optimizer.optimize(instance, tour);
+    const double flatSeconds = secondsSince(start);
+
+    std::cout << "multilevel (" << n << " clustered cities, " << pool.size() << " workers)" << std::endl;
+    std::cout << "  multilevel       length = " << multilevelLength
+              << " time = " << multilevelSeconds << "s" << std::endl;
+    std::cout << "  flat annealing   length = " << MultilevelSolver::tourLength(instance.getCities(), tour)
+              << " time = " << flatSeconds << "s" << std::endl;
+}
+
+/**
+ * Solves a directory of generated binary instances in batch mode and checks
+ * that every instance gets a complete tour
+ */
+static void benchBatchDirectory(int instances, int n)
+{
+    const std::string directory = "sa-bench.batch";
+    mkdir(directory.c_str(), 0755);
+    WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    InstanceGenerator generator(pool);
+    std::vector<std::string> written;
+    for (int i = 0; i < instances; i++)
+    {
+        generator.seed = i + 1;
+        std::vector<City> cities;
+        generator.generate(n, cities);
+        std::ostringstream name;
+        name << directory << "/" << i << ".bin";
+        std::ofstream stream(name.str().c_str(), std::ios::binary);
+        if (InstanceGenerator::writeBinary(cities, stream))
+        {
+            written.push_back(name.str());
+        }
+    }
+
+    std::vector<std::string> files;
+    BatchSolver::listInstances(directory, files);
+    ParameterizedOptimizer optimizer((AnnealingParameters()));
+    BatchSolver solver(optimizer, pool);
+    std::ostringstream out;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    solver.solve(files, out);
+    const double seconds = secondsSince(start);
+
+    // Every line has to report a tour through all cities
+    int solved = 0;
+    std::istringstream lines(out.str());
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        std::istringstream fields(line);
+        std::string file;
+        int cities = 0;
+        if (fields >> file >> cities && cities == n)
+        {
+            solved++;
+        }
+    }
+
+    std::cout << "batch directory (" << instances << " binary instances, " << n << " cities, "
+              << pool.size() << " workers)" << std::endl;
+    std::cout << "  listed = " << files.size() << " solved = " << solved
+              << " time = " << seconds << "s"
+              << (solved == instances ? "" : " (mismatch)") << std::endl;
+
+    for (size_t i = 0; i < written.size(); i++)
+    {
+        std::remove(written[i].c_str());
+    }
+    rmdir(directory.c_str());
+}
+
+/**
+ * Sends the same instance to a solver daemon several times over its Unix
+ * domain socket and compares the latency of the first request against the
+ * requests that hit the instance cache
+ */
+static void benchDaemon(int n, int requests)
+{
+    const std::string path = "sa-bench.sock";
+    WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    ParameterizedOptimizer optimizer((AnnealingParameters()));
+    SolverDaemon daemon(optimizer, pool);
+    std::thread server([&daemon, &path]() { daemon.run(path); });
+
+    // Wait until the daemon listens
+    int fd = -1;
+    for (int attempt = 0; attempt < 100 && fd < 0; attempt++)
+    {
+        fd = connectUnixSocket(path);
+        if (fd < 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    TSPInstance instance;
+    instance.createRandom(n);
+    std::ostringstream request;
+    request << "SOLVE 50 COORDS " << n << "\n";
+    for (int i = 0; i < n; i++)
+    {
+        request << instance.getCities()[i].first << " " << instance.getCities()[i].second << "\n";
+    }
+
+    bool success = fd >= 0;
+    double coldMicros = 0;
+    double cachedMicros = 0;
+    if (success)
+    {
+        SocketConnection connection(fd);
+        std::string line;
+        success = connection.write("PING\n") && connection.readLine(line) && line == "PONG";
+        for (int r = 0; r < requests && success; r++)
+        {
+            // Expect "OK <length> <solve us> <total us> <cached>" and a tour
+            // through all cities
+            std::string status;
+            std::string tourLine;
+            double length, solveMicros, totalMicros;
+            int cached = -1;
+            success = connection.write(request.str()) && connection.readLine(line) &&
+                    connection.readLine(tourLine);
+            std::istringstream header(line);
+            success = success && header >> status >> length >> solveMicros >> totalMicros >> cached &&
+                    status == "OK" && cached == (r > 0 ? 1 : 0);
+
+            std::vector<bool> visited(n, false);
+            std::istringstream tour(tourLine);
+            int city;
+            int count = 0;
+            while (success && tour >> city)
+            {
+                success = city >= 0 && city < n && !visited[city];
+                visited[city] = true;
+                count++;
+            }
+            success = success && count == n;
+            if (r == 0)
+            {
+                coldMicros = totalMicros;
+            }
+            else
+            {
+                cachedMicros += totalMicros / (requests - 1);
+            }
+        }
+    }
+
+    daemon.stop();
+    server.join();
+
+    std::cout << "solver daemon (" << n << " cities, " << requests << " requests, 50ms budget)" << std::endl;
+    std::cout << "  first request    time = " << coldMicros / 1000 << "ms" << std::endl;
+    std::cout << "  cached requests  mean time = " << cachedMicros / 1000 << "ms"
+              << (success ? "" : " (protocol error)") << std::endl;
+}
+
+int main(int argc, const char** argv)
+{
+    // Use the provided TSPLIB instance or a random one
+    TSPInstance instance;
+    if (argc > 1)
+    {
+        std::ifstream stream;
+        stream.open(argv[1], std::ios::binary);
+        if(!stream.is_open())
+        {
+            std::cout << "Cannot open data file.";
+            return 1;
+        }
+        if (!instance.read(stream) || instance.getCities().empty())
+        {
+            std::cout << "Cannot read data file.";
+            return 1;
+        }
+        stream.close();
+    }
+    else
+    {
+        instance.createRandom(200);
+    }
+    instance.calcDistanceMatrix();
+
+    benchCooperative(instance, 3);
+    benchLocalSearch(instance);
+    benchIncremental(2000, 100);
+    benchBatchedLevels(instance);
+    benchPopulation(instance, 3);
+    benchScaling();
+    benchDistanceMatrix(10000);
+    benchTourEncoding();
+    benchTracing(instance, 5);
+    benchMultilevel(13509);
+    benchBatchDirectory(8, 200);
+    benchDaemon(1000, 5);
+
+    return 0;
+}
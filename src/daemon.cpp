@@ -0,0 +1,360 @@
+#include "daemon.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <new>
+#include <sys/socket.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+/// SolverDaemon
+////////////////////////////////////////////////////////////////////////////////
+
+SolverDaemon::SolverDaemon(const Optimizer & prototype, WorkerPool & pool) :
+        cacheSize(64),
+        polishNeighbors(0),
+        maxPayloadBytes(64LL << 20),
+        maxCities(20000),
+        pool(pool),
+        listenSocket(-1),
+        stopped(false)
+{
+    for (int i = 0; i < pool.size(); i++)
+    {
+        optimizers.push_back(new OptimizerClone(prototype, false));
+    }
+}
+
+SolverDaemon::~SolverDaemon()
+{
+    for (size_t i = 0; i < optimizers.size(); i++)
+    {
+        DELETE_PTR(optimizers[i]);
+    }
+}
+
+bool SolverDaemon::run(const std::string & path)
+{
+    unsigned long long inode = 0;
+    const int fd = listenUnixSocket(path, &inode);
+    if (fd < 0)
+    {
+        return false;
+    }
+    listenSocket = fd;
+
+    while (!stopped)
+    {
+        const int client = accept(fd, 0, 0);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            // The socket has been shut down
+            break;
+        }
+
+        // Serve the client on its own thread. The instances themselves are
+        // solved on the worker pool
+        Session* session = new Session(client);
+        session->thread = std::thread(&SolverDaemon::serve, this, session);
+        {
+            std::lock_guard<std::mutex> lock(sessionMutex);
+            sessions.push_back(session);
+        }
+        reapSessions(false);
+    }
+
+    listenSocket = -1;
+    close(fd);
+    removeUnixSocket(path, inode);
+    reapSessions(true);
+    return true;
+}
+
+void SolverDaemon::stop()
+{
+    stopped = true;
+    const int fd = listenSocket;
+    if (fd >= 0)
+    {
+        // Wake up the accept call
+        ::shutdown(fd, SHUT_RDWR);
+    }
+}
+
+void SolverDaemon::reapSessions(bool all)
+{
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    for (std::list<Session*>::iterator it = sessions.begin(); it != sessions.end();)
+    {
+        Session* session = *it;
+        if (all)
+        {
+            // Wake up the client thread if it waits for a request
+            session->connection.shutdown();
+        }
+        if (all || session->finished)
+        {
+            session->thread.join();
+            DELETE_PTR(session);
+            it = sessions.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void SolverDaemon::serve(Session* session)
+{
+    SocketConnection & connection = session->connection;
+
+    // The cities of the current request. The buffer is reused between
+    // requests
+    TSPInstance cities;
+    std::string line;
+    while (!stopped && connection.readLine(line))
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        std::istringstream header(line);
+        std::string command;
+        header >> command;
+        if (command.empty())
+        {
+            continue;
+        }
+        if (command == "PING")
+        {
+            connection.write("PONG\n");
+            continue;
+        }
+        if (command != "SOLVE")
+        {
+            connection.write("ERROR Unknown command.\n");
+            continue;
+        }
+
+        float budget = 0;
+        std::string error;
+        if (!(header >> budget) || budget < 0)
+        {
+            error = "Invalid time budget.";
+        }
+        else
+        {
+            readCities(connection, header, cities, error);
+        }
+        if (!error.empty())
+        {
+            // We cannot know where the next request starts
+            connection.write("ERROR " + error + "\n");
+            break;
+        }
+
+        // Solve the instance on the pool
+        std::promise<std::string> response;
+        pool.submit([this, &cities, &response, budget, start](int worker) {
+            // A request that does not fit into memory must not bring down
+            // the daemon
+            try
+            {
+                bool cached = false;
+                std::shared_ptr<const CachedInstance> entry = lookup(cities, cached);
+
+                const std::chrono::steady_clock::time_point solveStart = std::chrono::steady_clock::now();
+                std::vector<int> tour;
+                const float length = solve(*entry, budget / 1000, worker, tour);
+                const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+                std::stringstream ss;
+                ss << "OK " << length << " "
+                   << std::chrono::duration_cast<std::chrono::microseconds>(end - solveStart).count() << " "
+                   << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " "
+                   << (cached ? 1 : 0) << "\n";
+                for (size_t i = 0; i < tour.size(); i++)
+                {
+                    ss << (i > 0 ? " " : "") << tour[i];
+                }
+                ss << "\n";
+                response.set_value(ss.str());
+            }
+            catch (const std::bad_alloc &)
+            {
+                response.set_value("ERROR Out of memory.\n");
+            }
+        });
+
+        if (!connection.write(response.get_future().get()))
+        {
+            break;
+        }
+    }
+
+    session->finished = true;
+}
+
+bool SolverDaemon::readCities(SocketConnection & connection, std::istringstream & header, TSPInstance & cities, std::string & error) const
+{
+    cities.clear();
+
+    std::string format;
+    long long size = -1;
+    header >> format >> size;
+    if (size < 0)
+    {
+        error = "Invalid payload size.";
+        return false;
+    }
+
+    if (format == "COORDS")
+    {
+        if (size > maxCities)
+        {
+            error = "Too many cities.";
+            return false;
+        }
+
+        // One city per line
+        std::string line;
+        for (long long i = 0; i < size; i++)
+        {
+            if (!connection.readLine(line))
+            {
+                error = "Unexpected end of payload.";
+                return false;
+            }
+            const char* begin = line.c_str();
+            char* end;
+            City city;
+            city.first = std::strtof(begin, &end);
+            if (end == begin)
+            {
+                error = "Invalid coordinates.";
+                return false;
+            }
+            begin = end;
+            city.second = std::strtof(begin, &end);
+            if (end == begin)
+            {
+                error = "Invalid coordinates.";
+                return false;
+            }
+            cities.addCity(city);
+        }
+    }
+    else if (format == "TSPLIB")
+    {
+        if (size > maxPayloadBytes)
+        {
+            error = "Payload too large.";
+            return false;
+        }
+
+        std::string payload(static_cast<size_t>(size), '\0');
+        if (!connection.read(&payload[0], payload.size()))
+        {
+            error = "Unexpected end of payload.";
+            return false;
+        }
+        std::istringstream stream(payload);
+        if (!cities.readTSPLIB(stream))
+        {
+            error = "Invalid TSPLIB file.";
+            return false;
+        }
+    }
+    else
+    {
+        error = "Unknown payload format.";
+        return false;
+    }
+
+    if (cities.getCities().size() < 3)
+    {
+        error = "Too few cities.";
+        return false;
+    }
+    if (static_cast<long long>(cities.getCities().size()) > maxCities)
+    {
+        error = "Too many cities.";
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const SolverDaemon::CachedInstance> SolverDaemon::lookup(const TSPInstance & cities, bool & cached)
+{
+    const uint64_t key = hash(cities.getCities());
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        std::map<uint64_t, std::shared_ptr<const CachedInstance> >::const_iterator it = cache.find(key);
+        // Rule out hash collisions
+        if (it != cache.end() && it->second->instance.getCities() == cities.getCities())
+        {
+            cached = true;
+            return it->second;
+        }
+    }
+
+    // Set up the instance outside of the lock
+    std::shared_ptr<CachedInstance> entry(new CachedInstance());
+    for (size_t i = 0; i < cities.getCities().size(); i++)
+    {
+        entry->instance.addCity(cities.getCities()[i]);
+    }
+    entry->instance.calcDistanceMatrix();
+    if (polishNeighbors > 0)
+    {
+        entry->neighbors.build(entry->instance, polishNeighbors);
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (cache.find(key) == cache.end())
+    {
+        cacheOrder.push_back(key);
+    }
+    cache[key] = entry;
+
+    // Evict the oldest instances
+    while (static_cast<int>(cacheOrder.size()) > cacheSize)
+    {
+        cache.erase(cacheOrder.front());
+        cacheOrder.pop_front();
+    }
+    cached = false;
+    return entry;
+}
+
+float SolverDaemon::solve(const CachedInstance & entry, float budget, int worker, std::vector<int> & tour)
+{
+    OptimizerClone & optimizer = *optimizers[worker];
+    TwoOptOrOptSearch search(entry.neighbors);
+    optimizer.localSearch = polishNeighbors > 0 ? &search : 0;
+    optimizer.timeLimit = budget;
+
+    optimizer.optimize(entry.instance, tour);
+    return entry.instance.calcTourLength(tour);
+}
+
+uint64_t SolverDaemon::hash(const std::vector<City> & cities)
+{
+    // FNV-1a over the raw coordinates
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < cities.size(); i++)
+    {
+        const float coords[2] = {cities[i].first, cities[i].second};
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(coords);
+        for (size_t j = 0; j < sizeof(coords); j++)
+        {
+            h ^= bytes[j];
+            h *= 1099511628211ULL;
+        }
+    }
+    return h;
+}
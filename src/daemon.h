@@ -0,0 +1,200 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tsp.h"
+#include "parallel.h"
+#include "localsearch.h"
+#include "pool.h"
+#include "net.h"
+
+/**
+ * This is a long-running solver that listens on a Unix domain socket. The
+ * protocol is line based. A client sends
+ *
+ *   SOLVE <budget ms> COORDS <n>       followed by n lines "x y", or
+ *   SOLVE <budget ms> TSPLIB <bytes>   followed by a TSPLIB file of that size
+ *
+ * and receives
+ *
+ *   OK <length> <solve us> <total us> <cached>
+ *   <tour>
+ *
+ * or "ERROR <message>". Requests above maxPayloadBytes or maxCities are
+ * rejected. A budget of 0 means that the annealing runs for the
+ * configured number of iterations. PING is answered with PONG. A connection
+ * may send any number of requests.
+ *
+ * The instances are solved on a pool of worker threads. Distance matrices and
+ * neighbor lists are cached by a hash of the city coordinates, such that
+ * repeated requests for the same instance skip the setup.
+ */
+class SolverDaemon {
+public:
+    /**
+     * Constructor. Every worker copies the parameters and moves of the
+     * prototype.
+     */
+    SolverDaemon(const Optimizer & prototype, WorkerPool & pool);
+
+    /**
+     * Destructor
+     */
+    ~SolverDaemon();
+
+    /**
+     * The maximum number of cached instances
+     */
+    int cacheSize;
+    /**
+     * The number of neighbors for the local search polish. Set to 0 in order
+     * to disable the polish
+     */
+    int polishNeighbors;
+    /**
+     * The maximum size of a TSPLIB payload in bytes. Larger requests are
+     * rejected before anything is allocated
+     */
+    long long maxPayloadBytes;
+    /**
+     * The maximum number of cities of a request. The distance matrix needs
+     * 4 bytes per pair of cities
+     */
+    long long maxCities;
+
+    /**
+     * Listens on a socket and serves clients until stop() is called. Returns
+     * false if the socket cannot be created.
+     */
+    bool run(const std::string & path);
+
+    /**
+     * Stops a running daemon. This method may be called from a signal
+     * handler.
+     */
+    void stop();
+
+private:
+    SolverDaemon(const SolverDaemon &);
+    SolverDaemon & operator=(const SolverDaemon &);
+
+    /**
+     * An instance with its precomputed data
+     */
+    class CachedInstance {
+    public:
+        /**
+         * The instance including the distance matrix
+         */
+        TSPInstance instance;
+        /**
+         * The neighbor lists for the polish
+         */
+        NeighborLists neighbors;
+    };
+
+    /**
+     * A connected client
+     */
+    class Session {
+    public:
+        /**
+         * Constructor
+         */
+        Session(int fd) : connection(fd), finished(false) {}
+
+        /**
+         * The connection
+         */
+        SocketConnection connection;
+        /**
+         * The thread that serves the client
+         */
+        std::thread thread;
+        /**
+         * Whether or not the client has been served
+         */
+        std::atomic<bool> finished;
+    };
+
+    /**
+     * Serves a single client
+     */
+    void serve(Session* session);
+
+    /**
+     * Reads the cities of a SOLVE request. Returns false and sets the error
+     * message if the request is invalid.
+     */
+    bool readCities(SocketConnection & connection, std::istringstream & header, TSPInstance & cities, std::string & error) const;
+
+    /**
+     * Returns the cached instance with the same cities or sets up a new one
+     */
+    std::shared_ptr<const CachedInstance> lookup(const TSPInstance & cities, bool & cached);
+
+    /**
+     * Solves an instance on a worker and returns the length of the tour. The
+     * budget is given in seconds.
+     */
+    float solve(const CachedInstance & entry, float budget, int worker, std::vector<int> & tour);
+
+    /**
+     * Joins the threads of all clients that have been served
+     */
+    void reapSessions(bool all);
+
+    /**
+     * Computes a content hash of the city coordinates
+     */
+    static uint64_t hash(const std::vector<City> & cities);
+
+    /**
+     * The worker pool
+     */
+    WorkerPool & pool;
+    /**
+     * One optimizer per worker
+     */
+    std::vector<OptimizerClone*> optimizers;
+    /**
+     * The listening socket
+     */
+    std::atomic<int> listenSocket;
+    /**
+     * Whether or not the daemon shall stop
+     */
+    std::atomic<bool> stopped;
+    /**
+     * The connected clients
+     */
+    std::list<Session*> sessions;
+    /**
+     * Protects the sessions
+     */
+    std::mutex sessionMutex;
+    /**
+     * The cached instances by content hash
+     */
+    std::map<uint64_t, std::shared_ptr<const CachedInstance> > cache;
+    /**
+     * The hashes of the cached instances from oldest to newest
+     */
+    std::deque<uint64_t> cacheOrder;
+    /**
+     * Protects the cache
+     */
+    std::mutex cacheMutex;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "generator.h"
+#include <cmath>
+#include <cstdio>
+
+////////////////////////////////////////////////////////////////////////////////
+/// InstanceGenerator
+////////////////////////////////////////////////////////////////////////////////
+
+void InstanceGenerator::generate(int n, std::vector<City> & cities) const
+{
+    assert(n >= 0);
+    cities.resize(n);
+
+    // The cluster centers do not depend on the blocks
+    std::vector<City> centers(std::max(1, clusters));
+    {
+        std::seed_seq sequence{seed, 0xffffffffu};
+        std::mt19937 generator(sequence);
+        std::uniform_real_distribution<float> positionDist(0.0f, size);
+        for (size_t c = 0; c < centers.size(); c++)
+        {
+            centers[c].first = positionDist(generator);
+            centers[c].second = positionDist(generator);
+        }
+    }
+
+    // The grid dimensions
+    const int side = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(n)))));
+    const float spacing = size / side;
+
+    const int numBlocks = (n + blockSize - 1) / blockSize;
+    for (int b = 0; b < numBlocks; b++)
+    {
+        pool.submit([this, b, n, side, spacing, &centers, &cities](int) {
+            std::seed_seq sequence{seed, static_cast<uint32_t>(b)};
+            std::mt19937 generator(sequence);
+            std::uniform_real_distribution<float> positionDist(0.0f, size);
+            std::uniform_real_distribution<float> noiseDist(-noise * spacing, noise * spacing);
+            std::uniform_int_distribution<int> clusterDist(0, static_cast<int>(centers.size()) - 1);
+            std::normal_distribution<float> normalDist(0.0f, spread * size);
+
+            const int end = std::min(n, (b + 1) * blockSize);
+            for (int i = b * blockSize; i < end; i++)
+            {
+                City & city = cities[i];
+                switch (distribution)
+                {
+                    case UNIFORM:
+                        city.first = positionDist(generator);
+                        city.second = positionDist(generator);
+                        break;
+
+                    case CLUSTERED:
+                    {
+                        // Resample points that fall outside of the square
+                        const City & center = centers[clusterDist(generator)];
+                        do {
+                            city.first = center.first + normalDist(generator);
+                            city.second = center.second + normalDist(generator);
+                        } while (city.first < 0 || city.first > size || city.second < 0 || city.second > size);
+                        break;
+                    }
+
+                    case GRID:
+                        city.first = ((i % side) + 0.5f) * spacing + noiseDist(generator);
+                        city.second = ((i / side) + 0.5f) * spacing + noiseDist(generator);
+                        break;
+                }
+            }
+        });
+    }
+    pool.wait();
+}
+
+bool InstanceGenerator::writeTSPLIB(const std::vector<City> & cities, const std::string & name, std::ostream & out) const
+{
+    const int n = static_cast<int>(cities.size());
+    out << "NAME : " << name << "\n"
+        << "TYPE : TSP\n"
+        << "DIMENSION : " << n << "\n"
+        << "EDGE_WEIGHT_TYPE : EUC_2D\n"
+        << "NODE_COORD_SECTION\n";
+
+    // Format one block per worker at a time and write them in order
+    const int numBlocks = (n + blockSize - 1) / blockSize;
+    std::vector<std::string> buffers(pool.size());
+    for (int first = 0; first < numBlocks && out; first += pool.size())
+    {
+        const int last = std::min(numBlocks, first + pool.size());
+        for (int b = first; b < last; b++)
+        {
+            pool.submit([b, n, first, &cities, &buffers](int) {
+                std::string & buffer = buffers[b - first];
+                buffer.clear();
+                char line[64];
+                const int end = std::min(n, (b + 1) * blockSize);
+                for (int i = b * blockSize; i < end; i++)
+                {
+                    const int length = std::snprintf(line, sizeof(line), "%d %.3f %.3f\n",
+                            i + 1, cities[i].first, cities[i].second);
+                    buffer.append(line, length);
+                }
+            });
+        }
+        pool.wait();
+
+        for (int b = first; b < last; b++)
+        {
+            out.write(buffers[b - first].data(), buffers[b - first].size());
+        }
+    }
+    out << "EOF\n";
+    return static_cast<bool>(out);
+}
+
+bool InstanceGenerator::writeBinary(const std::vector<City> & cities, std::ostream & out)
+{
+    const uint64_t n = cities.size();
+    out.write(TSPInstance::binaryMagic, 8);
+    out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+
+    // Write the coordinates in chunks
+    std::vector<float> buffer;
+    for (size_t first = 0; first < cities.size() && out; first += blockSize)
+    {
+        const size_t end = std::min(cities.size(), first + blockSize);
+        buffer.resize(2 * (end - first));
+        for (size_t i = first; i < end; i++)
+        {
+            buffer[2 * (i - first)] = cities[i].first;
+            buffer[2 * (i - first) + 1] = cities[i].second;
+        }
+        out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(float));
+    }
+    return static_cast<bool>(out);
+}
+
+bool InstanceGenerator::parseDistribution(const std::string & name, Distribution & distribution)
+{
+    if (name == "uniform")
+    {
+        distribution = UNIFORM;
+    }
+    else if (name == "clustered")
+    {
+        distribution = CLUSTERED;
+    }
+    else if (name == "grid")
+    {
+        distribution = GRID;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,109 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "tsp.h"
+#include "pool.h"
+
+/**
+ * This class generates large synthetic instances on a worker pool. The cities
+ * are produced in fixed blocks and every block has its own random generator
+ * that is seeded from the seed and the block index. Hence, the instance only
+ * depends on the parameters and the seed, but not on the number of workers.
+ */
+class InstanceGenerator {
+public:
+    /**
+     * The spatial distribution of the cities
+     */
+    enum Distribution {
+        /**
+         * Uniform on the square
+         */
+        UNIFORM,
+        /**
+         * A mixture of Gaussians with uniformly distributed centers
+         */
+        CLUSTERED,
+        /**
+         * A regular grid whose points are perturbed uniformly
+         */
+        GRID
+    };
+
+    /**
+     * Constructor
+     */
+    InstanceGenerator(WorkerPool & pool) :
+            distribution(UNIFORM),
+            seed(1),
+            size(1000),
+            clusters(20),
+            spread(0.02f),
+            noise(0.2f),
+            pool(pool) {}
+
+    /**
+     * The distribution of the cities
+     */
+    Distribution distribution;
+    /**
+     * The seed
+     */
+    uint32_t seed;
+    /**
+     * The side length of the square that contains the cities
+     */
+    float size;
+    /**
+     * The number of clusters of the clustered distribution
+     */
+    int clusters;
+    /**
+     * The standard deviation of the clusters relative to the side length
+     */
+    float spread;
+    /**
+     * The maximum perturbation of the grid points relative to the grid spacing
+     */
+    float noise;
+
+    /**
+     * Generates n cities. The vector is resized once and filled in parallel
+     */
+    void generate(int n, std::vector<City> & cities) const;
+
+    /**
+     * Writes the cities as TSPLIB instance. The lines are formatted in
+     * parallel. Returns false if the stream fails
+     */
+    bool writeTSPLIB(const std::vector<City> & cities, const std::string & name, std::ostream & out) const;
+
+    /**
+     * Writes the cities in the binary format of TSPInstance::readBinary.
+     * Returns false if the stream fails
+     */
+    static bool writeBinary(const std::vector<City> & cities, std::ostream & out);
+
+    /**
+     * Parses the name of a distribution. Returns false if it is unknown
+     */
+    static bool parseDistribution(const std::string & name, Distribution & distribution);
+
+private:
+    /**
+     * The number of cities per block
+     */
+    static const int blockSize = 1 << 16;
+
+    /**
+     * The worker pool
+     */
+    WorkerPool & pool;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "incremental.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// IncrementalSolver
+////////////////////////////////////////////////////////////////////////////////
+
+IncrementalSolver::IncrementalSolver(TSPInstance & instance, std::vector<int> & tour) :
+        window(50),
+        iterations(20000),
+        temperature(0.05f),
+        instance(instance),
+        tour(tour),
+        generator({std::random_device{}()})
+{
+    assert(tour.size() == instance.getCities().size());
+    length = instance.calcTourLength(tour);
+}
+
+int IncrementalSolver::insertCity(const City & city)
+{
+    const int n = static_cast<int>(tour.size());
+    const int c = instance.insertCity(city);
+
+    // Find the cheapest insertion position
+    int best = 0;
+    float bestCost = std::numeric_limits<float>::max();
+    for (int k = 0; k < n; k++)
+    {
+        const int a = tour[k];
+        const int b = tour[k + 1 == n ? 0 : k + 1];
+        const float cost = instance.dist(a, c) + instance.dist(c, b) - instance.dist(a, b);
+        if (cost < bestCost)
+        {
+            bestCost = cost;
+            best = k;
+        }
+    }
+    tour.insert(tour.begin() + best + 1, c);
+    length += bestCost;
+
+    repair(best + 1);
+    return c;
+}
+
+void IncrementalSolver::removeCity(int city)
+{
+    const int last = static_cast<int>(tour.size()) - 1;
+
+    // Cut the city out of the tour
+    const int position = static_cast<int>(std::find(tour.begin(), tour.end(), city) - tour.begin());
+    assert(position <= last);
+    const int p = tour[position == 0 ? last : position - 1];
+    const int s = tour[position == last ? 0 : position + 1];
+    length -= instance.dist(p, city) + instance.dist(city, s) - instance.dist(p, s);
+    tour.erase(tour.begin() + position);
+
+    // The last city takes over the index
+    instance.removeCity(city);
+    if (city != last)
+    {
+        *std::find(tour.begin(), tour.end(), last) = city;
+    }
+
+    repair(position == last ? 0 : position);
+}
+
+void IncrementalSolver::repair(int position)
+{
+    const int n = static_cast<int>(tour.size());
+    if (n < 5)
+    {
+        length = instance.calcTourLength(tour);
+        return;
+    }
+
+    // Copy the window into a path with two fixed anchors
+    const int size = std::min(2 * window + 1, n - 2);
+    const int start = ((position - size / 2) % n + n) % n;
+    path.resize(size);
+    for (int k = 0; k < size; k++)
+    {
+        path[k] = tour[(start + k) % n];
+    }
+    const int prev = tour[(start + n - 1) % n];
+    const int next = tour[(start + size) % n];
+    auto at = [this, prev, next, size](int k) {
+        return k < 0 ? prev : (k >= size ? next : path[k]);
+    };
+
+    // Anneal the path at a low temperature relative to the mean edge length
+    float temp = temperature * length / n;
+    const float alpha = std::pow(0.01f, 1.0f / std::max(1, iterations));
+    std::uniform_int_distribution<int> positionDist(0, size - 1);
+    std::uniform_int_distribution<int> moveDist(0, 1);
+    std::uniform_real_distribution<float> uniformDist(0.0f, 1.0f);
+
+    for (int it = 0; it < iterations; it++, temp *= alpha)
+    {
+        int i = positionDist(generator);
+        int j = positionDist(generator);
+        if (moveDist(generator) == 0)
+        {
+            // Reverse the chain path[i..j]
+            if (i == j)
+            {
+                continue;
+            }
+            if (i > j)
+            {
+                std::swap(i, j);
+            }
+            const int a = at(i - 1);
+            const int b = path[i];
+            const int c = path[j];
+            const int d = at(j + 1);
+            const float delta = instance.dist(a, c) + instance.dist(b, d) - instance.dist(a, b) - instance.dist(c, d);
+            if (delta <= 0 || uniformDist(generator) <= std::exp(-delta / temp))
+            {
+                std::reverse(path.begin() + i, path.begin() + j + 1);
+                length += delta;
+            }
+        }
+        else
+        {
+            // Move the city path[i] between the positions j and j + 1
+            if (j == i || j == i - 1)
+            {
+                continue;
+            }
+            const int x = path[i];
+            const int u = at(j);
+            const int v = at(j + 1);
+            const float delta = instance.dist(at(i - 1), at(i + 1)) - instance.dist(at(i - 1), x) - instance.dist(x, at(i + 1))
+                    + instance.dist(u, x) + instance.dist(x, v) - instance.dist(u, v);
+            if (delta <= 0 || uniformDist(generator) <= std::exp(-delta / temp))
+            {
+                if (j > i)
+                {
+                    std::rotate(path.begin() + i, path.begin() + i + 1, path.begin() + j + 1);
+                }
+                else
+                {
+                    std::rotate(path.begin() + j + 1, path.begin() + i, path.begin() + i + 1);
+                }
+                length += delta;
+            }
+        }
+    }
+
+    // Write the path back
+    for (int k = 0; k < size; k++)
+    {
+        tour[(start + k) % n] = path[k];
+    }
+
+    // Get rid of accumulated rounding errors
+    length = instance.calcTourLength(tour);
+}
@@ -0,0 +1,87 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <random>
+#include <vector>
+
+#include "tsp.h"
+
+/**
+ * This class keeps a tour up to date while cities are added to or removed
+ * from an instance. A new city is inserted at the cheapest position of the
+ * current tour, a removed city is simply cut out. Afterwards, a short
+ * low-temperature annealing pass repairs the tour around the change. Only
+ * the positions within a window around the change are touched, such that an
+ * update takes O(n) time for the bookkeeping plus a constant amount of
+ * annealing work.
+ */
+class IncrementalSolver {
+public:
+    /**
+     * Constructor. The distance matrix of the instance has to be set up and
+     * the tour has to visit all cities.
+     */
+    IncrementalSolver(TSPInstance & instance, std::vector<int> & tour);
+
+    /**
+     * Adds a city and returns its index
+     */
+    int insertCity(const City & city);
+
+    /**
+     * Removes a city. The city with the highest index takes over the index
+     * of the removed one.
+     */
+    void removeCity(int city);
+
+    /**
+     * Returns the length of the current tour
+     */
+    float getLength() const
+    {
+        return length;
+    }
+
+    /**
+     * The number of positions on either side of a change that are annealed
+     */
+    int window;
+    /**
+     * The number of proposals per repair pass
+     */
+    int iterations;
+    /**
+     * The initial temperature of a repair pass relative to the mean edge
+     * length. The temperature decreases geometrically to 1% of this value.
+     */
+    float temperature;
+
+private:
+    /**
+     * Anneals the positions around a position of the tour
+     */
+    void repair(int position);
+
+    /**
+     * The instance
+     */
+    TSPInstance & instance;
+    /**
+     * The tour
+     */
+    std::vector<int> & tour;
+    /**
+     * The length of the tour
+     */
+    float length;
+    /**
+     * The random number generator
+     */
+    std::mt19937 generator;
+    /**
+     * The cities of the annealed window
+     */
+    std::vector<int> path;
+};
+
+#endif
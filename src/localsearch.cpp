@@ -0,0 +1,330 @@
+#include "localsearch.h"
+#include <deque>
+
+////////////////////////////////////////////////////////////////////////////////
+/// NeighborLists
+////////////////////////////////////////////////////////////////////////////////
+
+void NeighborLists::build(const TSPInstance & instance, int _k)
+{
+    const int n = static_cast<int>(instance.getCities().size());
+    k = std::max(0, std::min(_k, n - 1));
+    lists.resize(static_cast<size_t>(n) * k);
+
+    std::vector<int> candidates;
+    candidates.reserve(n);
+    for (int i = 0; i < n; i++)
+    {
+        candidates.clear();
+        for (int j = 0; j < n; j++)
+        {
+            if (j != i)
+            {
+                candidates.push_back(j);
+            }
+        }
+
+        // Only the k closest cities have to be sorted
+        auto closer = [&instance, i](int a, int b) {
+            return instance.dist(i, a) < instance.dist(i, b);
+        };
+        std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end(), closer);
+        std::copy(candidates.begin(), candidates.begin() + k, lists.begin() + static_cast<size_t>(i) * k);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// TwoOptOrOptSearch
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A tour in array representation together with the position of every city.
+ * All modifications are expressed as 2-opt moves, i.e. as reversals.
+ */
+class ArrayTour {
+public:
+    /**
+     * Constructor
+     */
+    ArrayTour(std::vector<int> & tour) : tour(tour), pos(tour.size()), n(static_cast<int>(tour.size()))
+    {
+        for (int i = 0; i < n; i++)
+        {
+            pos[tour[i]] = i;
+        }
+    }
+
+    /**
+     * Returns the successor of a city
+     */
+    int succ(int city) const
+    {
+        const int i = pos[city] + 1;
+        return tour[i == n ? 0 : i];
+    }
+
+    /**
+     * Returns the predecessor of a city
+     */
+    int pred(int city) const
+    {
+        const int i = pos[city];
+        return tour[i == 0 ? n - 1 : i - 1];
+    }
+
+    /**
+     * Returns the next city in forward (dir = true) or backward direction
+     */
+    int next(int city, bool dir) const
+    {
+        return dir ? succ(city) : pred(city);
+    }
+
+    /**
+     * Removes the edges (a,b) and (c,d) and adds (a,c) and (b,d). The city d
+     * is implied: either b = succ(a) and d = succ(c), or b = pred(a) and
+     * d = pred(c).
+     */
+    void move2opt(int a, int b, int c)
+    {
+        if (succ(a) == b)
+        {
+            reversePath(b, c);
+        }
+        else
+        {
+            reversePath(c, b);
+        }
+    }
+
+private:
+    /**
+     * Reverses the path from city x forward to city y. If the path is longer
+     * than half the tour, the complement is reversed instead which yields the
+     * same cycle.
+     */
+    void reversePath(int x, int y)
+    {
+        int i = pos[x];
+        int j = pos[y];
+        int len = j - i;
+        if (len < 0)
+        {
+            len += n;
+        }
+        len++;
+        if (2 * len > n)
+        {
+            const int temp = i;
+            i = j + 1 == n ? 0 : j + 1;
+            j = temp == 0 ? n - 1 : temp - 1;
+            len = n - len;
+        }
+
+        for (int k = 0; k < len / 2; k++)
+        {
+            std::swap(tour[i], tour[j]);
+            pos[tour[i]] = i;
+            pos[tour[j]] = j;
+            i = i + 1 == n ? 0 : i + 1;
+            j = j == 0 ? n - 1 : j - 1;
+        }
+    }
+
+    /**
+     * The tour
+     */
+    std::vector<int> & tour;
+    /**
+     * The position of every city in the tour
+     */
+    std::vector<int> pos;
+    /**
+     * The number of cities
+     */
+    int n;
+};
+
+float TwoOptOrOptSearch::improve(const TSPInstance & instance, std::vector<int> & tour) const
+{
+    const int n = static_cast<int>(tour.size());
+    // Moves must improve by more than this in order to rule out cycling due
+    // to rounding errors
+    const float eps = 1e-4f;
+
+    if (n < 8 || lists.size() == 0)
+    {
+        return instance.calcTourLength(tour);
+    }
+
+    // Remember the first city. The optimizer keeps it at the front
+    const int first = tour[0];
+
+    ArrayTour t(tour);
+
+    // The queue of cities whose don't-look bits are off
+    std::deque<int> queue;
+    std::vector<char> active(n, 1);
+    for (int i = 0; i < n; i++)
+    {
+        queue.push_back(tour[i]);
+    }
+    auto activate = [&queue, &active](int city) {
+        if (!active[city])
+        {
+            active[city] = 1;
+            queue.push_back(city);
+        }
+    };
+
+    const int k = lists.size();
+
+    while (!queue.empty())
+    {
+        const int a = queue.front();
+        queue.pop_front();
+        active[a] = 0;
+
+        bool improved = false;
+        const int* neighbors = lists.of(a);
+
+        // 2-opt: Add the edge (a,c) for a candidate neighbor c
+        for (int dir = 0; dir < 2 && !improved; dir++)
+        {
+            const int b = t.next(a, dir == 0);
+            const float dab = instance.dist(a, b);
+            for (int i = 0; i < k; i++)
+            {
+                const int c = neighbors[i];
+                const float dac = instance.dist(a, c);
+                // The candidate lists are sorted, hence, no further neighbor
+                // can yield an improvement
+                if (dac >= dab)
+                {
+                    break;
+                }
+                const int d = t.next(c, dir == 0);
+                if (c == b || d == a)
+                {
+                    continue;
+                }
+                const float delta = dac + instance.dist(b, d) - dab - instance.dist(c, d);
+                if (delta < -eps)
+                {
+                    t.move2opt(a, b, c);
+                    activate(b);
+                    activate(c);
+                    activate(d);
+                    improved = true;
+                    break;
+                }
+            }
+        }
+
+        // Or-opt: Move the segment starting at a between a candidate neighbor
+        // and one of its tour neighbors
+        for (int dir = 0; dir < 2 && !improved; dir++)
+        {
+            const bool forward = dir == 0;
+            int s2 = a;
+            for (int len = 1; len <= maxSegmentLength && !improved; len++)
+            {
+                if (len > 1)
+                {
+                    s2 = t.next(s2, forward);
+                }
+                const int p = t.next(a, !forward);
+                const int nx = t.next(s2, forward);
+                if (nx == p || s2 == p)
+                {
+                    break;
+                }
+
+                // The gain of removing the segment
+                const float gain = instance.dist(p, a) + instance.dist(s2, nx) - instance.dist(p, nx);
+                if (gain <= eps)
+                {
+                    continue;
+                }
+
+                for (int i = 0; i < k && !improved; i++)
+                {
+                    const int c = neighbors[i];
+                    const float dac = instance.dist(a, c);
+                    if (dac >= gain)
+                    {
+                        break;
+                    }
+                    // c must not be part of the segment
+                    bool inside = false;
+                    for (int x = a, j = 0; j < len; j++, x = t.next(x, forward))
+                    {
+                        inside = inside || x == c;
+                    }
+                    if (inside)
+                    {
+                        continue;
+                    }
+
+                    for (int side = 0; side < 2; side++)
+                    {
+                        // Insert between c and e such that a is adjacent to c
+                        const bool after = side == 0;
+                        const int e = t.next(c, after == forward);
+                        bool eInside = false;
+                        for (int x = a, j = 0; j < len; j++, x = t.next(x, forward))
+                        {
+                            eInside = eInside || x == e;
+                        }
+                        if (eInside)
+                        {
+                            continue;
+                        }
+
+                        const float delta = dac + instance.dist(s2, e) - instance.dist(c, e) - gain;
+                        if (delta >= -eps)
+                        {
+                            continue;
+                        }
+
+                        // Name the insertion edge (c2,e2) such that e2 follows
+                        // c2 when walking from the segment towards nx. e2 is
+                        // the other one of c and e
+                        const int c2 = after ? c : e;
+
+                        // p a..s2 nx .. c2 e2  ->  p c2 .. nx s2..a e2
+                        t.move2opt(p, a, c2);
+                        // p c2 .. nx s2..a e2  ->  p nx .. c2 s2..a e2
+                        if (c2 != nx)
+                        {
+                            t.move2opt(p, c2, nx);
+                        }
+                        // Flip the segment such that a ends up next to c
+                        if (after)
+                        {
+                            t.move2opt(c2, s2, a);
+                        }
+
+                        activate(p);
+                        activate(nx);
+                        activate(s2);
+                        activate(c);
+                        activate(e);
+                        improved = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (improved)
+        {
+            activate(a);
+        }
+    }
+
+    // Restore the first city
+    std::rotate(tour.begin(), std::find(tour.begin(), tour.end(), first), tour.end());
+
+    return instance.calcTourLength(tour);
+}
@@ -0,0 +1,86 @@
+#ifndef LOCALSEARCH_H
+#define LOCALSEARCH_H
+
+#include <vector>
+
+#include "tsp.h"
+
+/**
+ * This class holds the k nearest neighbors of every city. The lists restrict
+ * the local search to promising candidate moves.
+ */
+class NeighborLists {
+public:
+    /**
+     * Constructor
+     */
+    NeighborLists() : k(0) {}
+
+    /**
+     * Computes the k nearest neighbors of every city of an instance. The
+     * distance matrix has to be set up.
+     */
+    void build(const TSPInstance & instance, int k);
+
+    /**
+     * Returns the neighbors of a city sorted by increasing distance
+     */
+    const int* of(int city) const
+    {
+        return &lists[static_cast<size_t>(city) * k];
+    }
+
+    /**
+     * Returns the number of neighbors per city
+     */
+    int size() const
+    {
+        return k;
+    }
+
+private:
+    /**
+     * The number of neighbors per city
+     */
+    int k;
+    /**
+     * The neighbors of all cities, k entries per city
+     */
+    std::vector<int> lists;
+};
+
+/**
+ * This local search applies improving 2-opt and Or-opt moves until it reaches
+ * a local optimum. Only moves that add an edge between a city and one of its
+ * candidate neighbors are considered. Don't-look bits make sure that only
+ * cities close to recent changes are examined again, such that the search
+ * runs in near-linear time.
+ */
+class TwoOptOrOptSearch : public Optimizer::LocalSearch {
+public:
+    /**
+     * Constructor. The neighbor lists must belong to the instances the
+     * search is run on.
+     */
+    TwoOptOrOptSearch(const NeighborLists & lists) :
+            maxSegmentLength(3),
+            lists(lists) {}
+
+    /**
+     * Improves the tour in place and returns its new length
+     */
+    virtual float improve(const TSPInstance & instance, std::vector<int> & tour) const;
+
+    /**
+     * The maximum number of cities Or-opt moves at once
+     */
+    int maxSegmentLength;
+
+private:
+    /**
+     * The candidate neighbors
+     */
+    const NeighborLists & lists;
+};
+
+#endif
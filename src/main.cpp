@@ -1,62 +1,596 @@
 #include "tsp.h"
+#include "parallel.h"
+#include "population.h"
+#include "localsearch.h"
+#include "batch.h"
+#include "daemon.h"
+#include "recorder.h"
+#include "generator.h"
+#include "replica.h"
+#include "trace.h"
+#include "tuner.h"
+#include "multilevel.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <map>
 #include <string>
 
+/**
+ * Splits an address of the form [host:]port. The host defaults to localhost
+ */
+static void parseAddress(const std::string & address, std::string & host, int & port)
+{
+    const size_t colon = address.rfind(':');
+    host = colon == std::string::npos ? "127.0.0.1" : address.substr(0, colon);
+    port = std::atoi(address.c_str() + (colon == std::string::npos ? 0 : colon + 1));
+}
+
+/**
+ * The running daemon. It is stopped on SIGINT and SIGTERM
+ */
+static SolverDaemon* runningDaemon = 0;
+
+static void stopDaemon(int)
+{
+    if (runningDaemon != 0)
+    {
+        runningDaemon->stop();
+    }
+}
+
 int main(int argc, const char** argv)
 {
+    // Parse the command line: 
+    // sa [--chains N [--population]] [--polish] [--polish-levels] [--headless] 
+    //    [--record video.avi|frames/%05d.png] [file.tsp]
+    // sa --batch list|directory [--workers N] [--polish]
+    // sa --daemon socket [--workers N] [--polish] [--max-cities N] 
+    //    [--max-payload BYTES]
+    // sa --coordinator [host:]port [--replicas K] [file.tsp]
+    // sa --worker host:port [--chains N]
+    // sa --multilevel file.tsp [--workers N]
+    // sa --tune space.txt [--random N] [--seeds K] [--target GAP] 
+    //    [--instances list|directory] [--workers N]
+    // sa --trace2csv trace.bin
+    // All solving modes accept --trace trace.bin, --params params.txt and 
+    // --seed S
+    // sa --generate uniform|clustered|grid N out.tsp|out.bin [--seed S] 
+    //    [--workers N]
+    const char* file = 0;
+    const char* batch = 0;
+    const char* daemon = 0;
+    const char* record = 0;
+    const char* generate = 0;
+    int generateCount = 0;
+    const char* generateFile = 0;
+    uint32_t seed = 0;
+    const char* tune = 0;
+    const char* params = 0;
+    const char* instancesPath = 0;
+    int randomSearch = 0;
+    int seeds = 3;
+    float target = -1;
+    const char* coordinator = 0;
+    const char* worker = 0;
+    int replicas = 1;
+    const char* trace = 0;
+    const char* traceToCSV = 0;
+    bool headless = false;
+    bool population = false;
+    bool multilevel = false;
+    long long maxCities = -1;
+    long long maxPayload = -1;
+    int chains = 1;
+    int workers = std::max(1u, std::thread::hardware_concurrency());
+    bool polish = false;
+    bool polishLevels = false;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--chains" && i + 1 < argc)
+        {
+            chains = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--population")
+        {
+            population = true;
+        }
+        else if (arg == "--multilevel")
+        {
+            multilevel = true;
+        }
+        else if (arg == "--max-cities" && i + 1 < argc)
+        {
+            maxCities = std::atoll(argv[++i]);
+        }
+        else if (arg == "--max-payload" && i + 1 < argc)
+        {
+            maxPayload = std::atoll(argv[++i]);
+        }
+        else if (arg == "--polish")
+        {
+            polish = true;
+        }
+        else if (arg == "--polish-levels")
+        {
+            polish = true;
+            polishLevels = true;
+        }
+        else if (arg == "--batch" && i + 1 < argc)
+        {
+            batch = argv[++i];
+        }
+        else if (arg == "--daemon" && i + 1 < argc)
+        {
+            daemon = argv[++i];
+        }
+        else if (arg == "--generate" && i + 3 < argc)
+        {
+            generate = argv[++i];
+            generateCount = std::max(0, std::atoi(argv[++i]));
+            generateFile = argv[++i];
+        }
+        else if (arg == "--coordinator" && i + 1 < argc)
+        {
+            coordinator = argv[++i];
+        }
+        else if (arg == "--worker" && i + 1 < argc)
+        {
+            worker = argv[++i];
+        }
+        else if (arg == "--replicas" && i + 1 < argc)
+        {
+            replicas = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--trace" && i + 1 < argc)
+        {
+            trace = argv[++i];
+        }
+        else if (arg == "--trace2csv" && i + 1 < argc)
+        {
+            traceToCSV = argv[++i];
+        }
+        else if (arg == "--tune" && i + 1 < argc)
+        {
+            tune = argv[++i];
+        }
+        else if (arg == "--params" && i + 1 < argc)
+        {
+            params = argv[++i];
+        }
+        else if (arg == "--instances" && i + 1 < argc)
+        {
+            instancesPath = argv[++i];
+        }
+        else if (arg == "--random" && i + 1 < argc)
+        {
+            randomSearch = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (arg == "--seeds" && i + 1 < argc)
+        {
+            seeds = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--target" && i + 1 < argc)
+        {
+            target = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], 0, 10));
+        }
+        else if (arg == "--headless")
+        {
+            headless = true;
+        }
+        else if (arg == "--record" && i + 1 < argc)
+        {
+            record = argv[++i];
+        }
+        else if (arg == "--workers" && i + 1 < argc)
+        {
+            workers = std::max(1, std::atoi(argv[++i]));
+        }
+        else
+        {
+            file = argv[i];
+        }
+    }
+    
+    if (traceToCSV != 0)
+    {
+        // Convert a trace file
+        std::ifstream stream(traceToCSV, std::ios::binary);
+        if (!stream.is_open() || !TraceRecorder::convertToCSV(stream, std::cout))
+        {
+            std::cout << "Cannot read trace file.";
+            return 1;
+        }
+        return 0;
+    }
+    
+    if (generate != 0)
+    {
+        // Write a synthetic instance without solving it
+        WorkerPool pool(workers);
+        InstanceGenerator generator(pool);
+        generator.seed = seed != 0 ? seed : 1;
+        if (!InstanceGenerator::parseDistribution(generate, generator.distribution))
+        {
+            std::cout << "Unknown distribution.";
+            return 1;
+        }
+        std::vector<City> cities;
+        generator.generate(generateCount, cities);
+        
+        const std::string path = generateFile;
+        const bool binary = path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+        std::ofstream stream(generateFile, std::ios::binary);
+        if (!stream.is_open())
+        {
+            std::cout << "Cannot open output file.";
+            return 1;
+        }
+        const bool success = binary ? InstanceGenerator::writeBinary(cities, stream) : 
+                generator.writeTSPLIB(cities, generate, stream);
+        if (!success)
+        {
+            std::cout << "Cannot write output file.";
+            return 1;
+        }
+        return 0;
+    }
+    
+    if (tune != 0)
+    {
+        // Evaluate a parameter space on a set of instances
+        std::ifstream stream(tune);
+        ParameterSpace space;
+        std::string error;
+        if (!stream.is_open() || !space.read(stream, error))
+        {
+            std::cout << (error.empty() ? "Cannot open parameter file." : error);
+            return 1;
+        }
+        std::vector<AnnealingParameters> configurations;
+        if (randomSearch > 0)
+        {
+            space.sample(randomSearch, seed != 0 ? seed : 1, configurations);
+        }
+        else if (!space.grid(configurations))
+        {
+            std::cout << "Ranges require --random N.";
+            return 1;
+        }
+        
+        // Load the instances or generate a few random ones
+        WorkerPool pool(workers);
+        std::vector<std::string> files;
+        if (instancesPath != 0 && !BatchSolver::listInstances(instancesPath, files))
+        {
+            std::cout << "Cannot open instances.";
+            return 1;
+        }
+        std::vector<const TSPInstance*> instances;
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            std::ifstream instanceStream(files[i].c_str(), std::ios::binary);
+            TSPInstance* instance = new TSPInstance();
+            if (!instanceStream.is_open() || !instance->read(instanceStream) || instance->getCities().size() < 3)
+            {
+                std::cout << "Skipping " << files[i] << std::endl;
+                DELETE_PTR(instance);
+                continue;
+            }
+            instance->calcDistanceMatrix(pool);
+            instances.push_back(instance);
+        }
+        if (instancesPath == 0)
+        {
+            InstanceGenerator generator(pool);
+            for (unsigned int i = 1; i <= 4; i++)
+            {
+                std::vector<City> cities;
+                generator.seed = i;
+                generator.generate(200, cities);
+                TSPInstance* instance = new TSPInstance();
+                instance->swapCities(cities);
+                instance->calcDistanceMatrix(pool);
+                instances.push_back(instance);
+            }
+        }
+        
+        if (instances.empty())
+        {
+            std::cout << "No instances.";
+            return 1;
+        }
+        
+        Tuner tuner(pool);
+        tuner.numSeeds = seeds;
+        tuner.seed = seed != 0 ? seed : 1;
+        std::vector<TuningResult> results;
+        tuner.evaluate(instances, configurations, results);
+        for (size_t i = 0; i < instances.size(); i++)
+        {
+            delete instances[i];
+        }
+        
+        // Report the configurations that are not dominated. Everything but the 
+        // chosen configuration is a comment, so the output is a parameter file
+        std::vector<int> front;
+        Tuner::paretoFront(results, front);
+        std::cout << "# " << configurations.size() << " configurations, " << front.size() 
+                  << " on the Pareto front" << std::endl;
+        std::cout << "# gap [%]\tseconds\tparameters" << std::endl;
+        for (size_t i = 0; i < front.size(); i++)
+        {
+            const TuningResult & r = results[front[i]];
+            std::cout << "# " << r.gap << "\t" << r.seconds << "\t" << r.parameters.toString() << std::endl;
+        }
+        
+        // Pick the cheapest configuration that reaches the target. Without 
+        // target, pick the best one
+        int choice = front.empty() ? -1 : front.back();
+        for (size_t i = 0; i < front.size() && target >= 0; i++)
+        {
+            if (results[front[i]].gap <= target)
+            {
+                choice = front[i];
+                break;
+            }
+        }
+        if (choice >= 0)
+        {
+            std::cout << "# Chosen configuration" << std::endl;
+            results[choice].parameters.write(std::cout);
+        }
+        return 0;
+    }
+    
+    // Choose the annealing parameters 
+    AnnealingParameters parameters;
+    if (params != 0)
+    {
+        std::ifstream stream(params);
+        ParameterSpace space;
+        std::string error;
+        if (!stream.is_open() || !space.read(stream, error))
+        {
+            std::cout << (error.empty() ? "Cannot open parameter file." : error);
+            return 1;
+        }
+        parameters = space.first();
+    }
+    
+    // Set up the optimizer with its moves and cooling schedule
+    ParameterizedOptimizer optimizer(parameters);
+    optimizer.seed = seed;
+    // Update the GUI every 2000 iterations
+    optimizer.notificationCycle = 1000;
+    
+    // Record the trajectory of every chain
+    TraceRecorder tracer;
+    if (trace != 0)
+    {
+        if (!tracer.open(trace))
+        {
+            std::cout << "Cannot open trace file.";
+            return 1;
+        }
+        optimizer.tracer = &tracer;
+    }
+    
+    if (batch != 0)
+    {
+        // Solve all instances of the batch without GUI
+        std::vector<std::string> files;
+        if (!BatchSolver::listInstances(batch, files))
+        {
+            std::cout << "Cannot open batch.";
+            return 1;
+        }
+        
+        WorkerPool pool(workers);
+        BatchSolver solver(optimizer, pool);
+        solver.polishNeighbors = polish ? 8 : 0;
+        solver.solve(files, std::cout);
+        return 0;
+    }
+    
+    if (daemon != 0)
+    {
+        // Serve requests on a Unix domain socket without GUI
+        WorkerPool pool(workers);
+        SolverDaemon solver(optimizer, pool);
+        solver.polishNeighbors = polish ? 8 : 0;
+        if (maxCities >= 0)
+        {
+            solver.maxCities = maxCities;
+        }
+        if (maxPayload >= 0)
+        {
+            solver.maxPayloadBytes = maxPayload;
+        }
+        
+        runningDaemon = &solver;
+        std::signal(SIGINT, stopDaemon);
+        std::signal(SIGTERM, stopDaemon);
+        const bool success = solver.run(daemon);
+        runningDaemon = 0;
+        if (!success)
+        {
+            std::cout << "Cannot open socket " << daemon << ": " << std::strerror(errno) << ".";
+            return 1;
+        }
+        return 0;
+    }
+    
+    if (worker != 0)
+    {
+        // Anneal the instance of a coordinator without GUI
+        std::string host;
+        int port;
+        parseAddress(worker, host, port);
+        
+        GapMigrationPolicy policy(5, 0.02f);
+        ReplicaWorker replica(optimizer);
+        replica.numChains = chains;
+        replica.migrationPolicy = &policy;
+        if (!replica.run(host, port))
+        {
+            std::cout << "Cannot connect to coordinator.";
+            return 1;
+        }
+        return 0;
+    }
+    
     // Set up a random problem instance 
     TSPInstance instance;
-    if (argc > 1)
+    if (file != 0)
     {
         std::ifstream stream;
-        stream.open(argv[1]);
+        stream.open(file, std::ios::binary);
         if(!stream.is_open())
         {
             std::cout << "Cannot open data file.";
             return 1;
         }
-        instance.readTSPLIB(stream);
+        if (!instance.read(stream) || instance.getCities().empty())
+        {
+            std::cout << "Cannot read data file.";
+            return 1;
+        }
         stream.close();
     }
     else
     {
         instance.createRandom(50);
     }
-    instance.calcDistanceMatrix();
     
-    // Set up the optimizer 
-    Optimizer optimizer;
+    if (multilevel)
+    {
+        // Solve a large instance without GUI and without distance matrix
+        WorkerPool pool(workers);
+        MultilevelSolver solver(optimizer, pool);
+        solver.seed = seed;
+        std::vector<int> result;
+        std::cout << solver.solve(instance, result) << std::endl;
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            std::cout << (i > 0 ? " " : "") << result[i];
+        }
+        std::cout << std::endl;
+        return 0;
+    }
+    
+    {
+        WorkerPool pool(workers);
+        instance.calcDistanceMatrix(pool);
+    }
     
-    // Register the moves
-    ChainReverseMove move1;
-    SwapCityMove move2;
-    RotateCityMove move3;
-    optimizer.addMove(&move1);
-    optimizer.addMove(&move2);
-    optimizer.addMove(&move3);
+    if (coordinator != 0)
+    {
+        // Exchange the best tours between the worker processes and print 
+        // the result
+        std::string host;
+        int port;
+        parseAddress(coordinator, host, port);
+        
+        ReplicaCoordinator replica(instance);
+        replica.numWorkers = replicas;
+        std::vector<int> result;
+        if (!replica.run(host, port, result))
+        {
+            std::cout << "Cannot open socket.";
+            return 1;
+        }
+        if (result.empty())
+        {
+            std::cout << "No worker has finished.";
+            return 1;
+        }
+        std::cout << instance.calcTourLength(result) << std::endl;
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            std::cout << (i > 0 ? " " : "") << result[i];
+        }
+        std::cout << std::endl;
+        return 0;
+    }
     
     // Register the GUI
     // You can specify the dimensions of the window
-    RuntimeGUI gui(750, 750);
+    RuntimeGUI gui(750, 750, headless);
     optimizer.addObserver(&gui);
     
+    // Record the frames on a background thread
+    FrameRecorder* recorder = 0;
+    if (record != 0)
+    {
+        if (!FrameRecorder::isValidPath(record))
+        {
+            std::cout << "Invalid recording path. Use a single %d pattern such as frames/%05d.png.";
+            return 1;
+        }
+        recorder = new FrameRecorder(record);
+        gui.recorder = recorder;
+    }
+    
     // The time the GUI stops after each iterations. Set to 0 to wait for a 
     // keypress
     gui.waitTime = 7;
     
-    // Choose a cooling schedule
-    GeometricCoolingSchedule schedule(150, 1e-2, 0.95);
-    optimizer.coolingSchedule = &schedule;
-    
-    // Optimizer loop counts
-    optimizer.outerLoops = 100;
-    optimizer.innerLoops = 5000;
-    // Update the GUI every 2000 iterations
-    optimizer.notificationCycle = 1000;
+    // Polish the result with 2-opt and Or-opt moves between the 8 nearest 
+    // neighbors
+    NeighborLists neighbors;
+    TwoOptOrOptSearch localSearch(neighbors);
+    if (polish)
+    {
+        neighbors.build(instance, 8);
+        optimizer.localSearch = &localSearch;
+        optimizer.localSearchEachLevel = polishLevels;
+    }
     
     // Run the program
     std::vector<int> result;
-    optimizer.optimize(instance, result);
+    if (chains > 1 && population)
+    {
+        // Every 5 temperature levels, the weaker half of the chains is 
+        // replaced by the offspring of the stronger half
+        PartitionCrossover crossover;
+        PopulationOptimizer populationOptimizer(optimizer, crossover);
+        populationOptimizer.numChains = chains;
+        populationOptimizer.interval = 5;
+        populationOptimizer.optimize(instance, result);
+    }
+    else if (chains > 1)
+    {
+        // Run several cooperating chains. Every 5 temperature levels, chains
+        // that are more than 2% above the global best adopt it
+        GapMigrationPolicy policy(5, 0.02f);
+        CooperativeOptimizer cooperative(optimizer);
+        cooperative.numChains = chains;
+        cooperative.migrationPolicy = &policy;
+        cooperative.optimize(instance, result);
+    }
+    else
+    {
+        optimizer.optimize(instance, result);
+    }
+    
+    if (recorder != 0)
+    {
+        recorder->close();
+        const bool failed = recorder->hasFailed();
+        DELETE_PTR(recorder);
+        if (failed)
+        {
+            std::cout << "Cannot write recording " << record << ".";
+            return 1;
+        }
+    }
     
     return 0;
-}
\ No newline at end of file
+}
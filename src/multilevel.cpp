@@ -0,0 +1,425 @@
+#include "multilevel.h"
+#include "parallel.h"
+#include "tuner.h"
+#include <cmath>
+
+////////////////////////////////////////////////////////////////////////////////
+/// Coarsening
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The number of neighbors a city may be matched with
+ */
+static const int numMatchingNeighbors = 6;
+
+/**
+ * Computes the k nearest neighbors of every city with a uniform grid. The
+ * neighbors of city i are stored at i * k sorted by increasing distance.
+ * Missing neighbors are -1
+ */
+static void nearestNeighbors(const std::vector<City> & cities, int k, std::vector<int> & lists)
+{
+    const int n = static_cast<int>(cities.size());
+    lists.assign(static_cast<size_t>(n) * k, -1);
+    if (n < 2)
+    {
+        return;
+    }
+
+    float minX = cities[0].first, maxX = minX;
+    float minY = cities[0].second, maxY = minY;
+    for (int i = 1; i < n; i++)
+    {
+        minX = std::min(minX, cities[i].first);
+        maxX = std::max(maxX, cities[i].first);
+        minY = std::min(minY, cities[i].second);
+        maxY = std::max(maxY, cities[i].second);
+    }
+
+    // About two cities per cell. Instances on a line get at most n cells
+    const double width = std::max(maxX - minX, 1e-6f);
+    const double height = std::max(maxY - minY, 1e-6f);
+    const double cellSize = std::max(std::sqrt(width * height * 2 / n), std::max(width, height) / n);
+    const int nx = static_cast<int>(width / cellSize) + 1;
+    const int ny = static_cast<int>(height / cellSize) + 1;
+
+    // Sort the cities into the cells
+    std::vector<int> cellOf(n);
+    std::vector<int> cellStart(static_cast<size_t>(nx) * ny + 1, 0);
+    for (int i = 0; i < n; i++)
+    {
+        const int cx = std::min(nx - 1, static_cast<int>((cities[i].first - minX) / cellSize));
+        const int cy = std::min(ny - 1, static_cast<int>((cities[i].second - minY) / cellSize));
+        cellOf[i] = cx + cy * nx;
+        cellStart[cellOf[i] + 1]++;
+    }
+    for (size_t c = 1; c < cellStart.size(); c++)
+    {
+        cellStart[c] += cellStart[c - 1];
+    }
+    std::vector<int> cellCities(n);
+    std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    for (int i = 0; i < n; i++)
+    {
+        cellCities[fill[cellOf[i]]++] = i;
+    }
+
+    // Search the rings of cells around every city until no closer city can
+    // be found
+    std::vector<std::pair<float, int> > best;
+    for (int i = 0; i < n; i++)
+    {
+        const int cx = cellOf[i] % nx;
+        const int cy = cellOf[i] / nx;
+        best.clear();
+        for (int r = 0; r <= std::max(nx, ny); r++)
+        {
+            for (int y = cy - r; y <= cy + r; y++)
+            {
+                if (y < 0 || y >= ny)
+                {
+                    continue;
+                }
+                // Inner rows of the ring only have their two outer cells
+                const int step = (y == cy - r || y == cy + r) ? 1 : std::max(1, 2 * r);
+                for (int x = cx - r; x <= cx + r; x += step)
+                {
+                    if (x < 0 || x >= nx)
+                    {
+                        continue;
+                    }
+                    const int cell = x + y * nx;
+                    for (int c = cellStart[cell]; c < cellStart[cell + 1]; c++)
+                    {
+                        const int j = cellCities[c];
+                        const float dx = cities[i].first - cities[j].first;
+                        const float dy = cities[i].second - cities[j].second;
+                        const std::pair<float, int> candidate(dx*dx + dy*dy, j);
+                        if (j == i || (static_cast<int>(best.size()) == k && !(candidate < best.back())))
+                        {
+                            continue;
+                        }
+                        if (static_cast<int>(best.size()) == k)
+                        {
+                            best.pop_back();
+                        }
+                        best.insert(std::upper_bound(best.begin(), best.end(), candidate), candidate);
+                    }
+                }
+            }
+
+            // Cities outside of the rings so far are at least r cells away
+            const double reach = r * cellSize;
+            if (static_cast<int>(best.size()) == k && best.back().first <= reach * reach)
+            {
+                break;
+            }
+        }
+
+        for (size_t b = 0; b < best.size(); b++)
+        {
+            lists[static_cast<size_t>(i) * k + b] = best[b].second;
+        }
+    }
+}
+
+/**
+ * Merges every city with its nearest unmatched neighbor. The merged city is
+ * placed at the centroid of the cities it stands for. The cities of coarse
+ * city c are children[2c] and children[2c + 1], the latter is -1 if c stands
+ * for a single city.
+ */
+static void coarsen(const std::vector<City> & cities, const std::vector<int> & weights, std::mt19937 & generator,
+        std::vector<City> & coarse, std::vector<int> & coarseWeights, std::vector<int> & children)
+{
+    const int n = static_cast<int>(cities.size());
+    std::vector<int> lists;
+    nearestNeighbors(cities, numMatchingNeighbors, lists);
+
+    // Visit the cities in random order, such that the matching does not
+    // follow the input order
+    std::vector<int> order(n);
+    for (int i = 0; i < n; i++)
+    {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), generator);
+
+    std::vector<char> matched(n, 0);
+    coarse.clear();
+    coarseWeights.clear();
+    children.clear();
+    for (int o = 0; o < n; o++)
+    {
+        const int u = order[o];
+        if (matched[u])
+        {
+            continue;
+        }
+        matched[u] = 1;
+
+        int v = -1;
+        for (int k = 0; k < numMatchingNeighbors; k++)
+        {
+            const int candidate = lists[static_cast<size_t>(u) * numMatchingNeighbors + k];
+            if (candidate >= 0 && !matched[candidate])
+            {
+                v = candidate;
+                break;
+            }
+        }
+
+        children.push_back(u);
+        children.push_back(v);
+        if (v < 0)
+        {
+            coarse.push_back(cities[u]);
+            coarseWeights.push_back(weights[u]);
+            continue;
+        }
+        matched[v] = 1;
+        const float total = static_cast<float>(weights[u] + weights[v]);
+        coarse.push_back(std::make_pair(
+                (weights[u] * cities[u].first + weights[v] * cities[v].first) / total,
+                (weights[u] * cities[u].second + weights[v] * cities[v].second) / total));
+        coarseWeights.push_back(weights[u] + weights[v]);
+    }
+}
+
+/**
+ * Replaces every coarse city of a tour by the cities it stands for. Pairs are
+ * oriented such that the first city is the one closer to its predecessor
+ */
+static void expand(const std::vector<City> & cities, const std::vector<int> & children, const std::vector<int> & coarseTour, std::vector<int> & tour)
+{
+    tour.clear();
+    for (size_t i = 0; i < coarseTour.size(); i++)
+    {
+        int a = children[2 * coarseTour[i]];
+        int b = children[2 * coarseTour[i] + 1];
+        if (b < 0)
+        {
+            tour.push_back(a);
+            continue;
+        }
+        if (!tour.empty())
+        {
+            const City & previous = cities[tour.back()];
+            const float da = std::hypot(previous.first - cities[a].first, previous.second - cities[a].second);
+            const float db = std::hypot(previous.first - cities[b].first, previous.second - cities[b].second);
+            if (db < da)
+            {
+                std::swap(a, b);
+            }
+        }
+        tour.push_back(a);
+        tour.push_back(b);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Refinement
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Anneals a window of w consecutive cities of a tour. The first and the last
+ * city of the window stay in place. The window is only changed if its path
+ * gets shorter.
+ */
+static void refineWindow(const std::vector<City> & cities, const Optimizer & refiner, unsigned int seed, int* window, int w)
+{
+    std::vector<City> local(w);
+    for (int k = 0; k < w; k++)
+    {
+        local[k] = cities[window[k]];
+    }
+    TSPInstance instance;
+    instance.swapCities(local);
+    instance.calcDistanceMatrix();
+
+    std::vector<int> initial(w);
+    float length = 0;
+    for (int k = 0; k < w; k++)
+    {
+        initial[k] = k;
+        if (k > 0)
+        {
+            length += instance.dist(k - 1, k);
+        }
+    }
+
+    // The edge between the ends of the window closes the tour. It is made so
+    // short that removing it never pays off, hence the ends stay connected
+    // to the rest of the tour
+    instance.setDistance(0, w - 1, -2 * length - 1);
+
+    OptimizerClone chain(refiner, false);
+    chain.seed = seed;
+    std::vector<int> result;
+    chain.optimize(instance, initial, result);
+
+    // The tour may run through the window backwards
+    if (result[w - 1] != w - 1)
+    {
+        if (result[1] != w - 1)
+        {
+            return;
+        }
+        std::reverse(result.begin() + 1, result.end());
+    }
+
+    float refined = 0;
+    for (int k = 1; k < w; k++)
+    {
+        refined += instance.dist(result[k - 1], result[k]);
+    }
+    if (refined >= length)
+    {
+        return;
+    }
+
+    // The ends are shared with the neighboring windows, which are refined at
+    // the same time. Only the interior is written back
+    const std::vector<int> ids(window, window + w);
+    for (int k = 1; k < w - 1; k++)
+    {
+        window[k] = ids[result[k]];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// MultilevelSolver
+////////////////////////////////////////////////////////////////////////////////
+
+double MultilevelSolver::tourLength(const std::vector<City> & cities, const std::vector<int> & tour)
+{
+    double length = 0;
+    for (size_t i = 0; i < tour.size(); i++)
+    {
+        const City & a = cities[tour[i]];
+        const City & b = cities[tour[i + 1 == tour.size() ? 0 : i + 1]];
+        length += std::hypot(static_cast<double>(a.first) - b.first, static_cast<double>(a.second) - b.second);
+    }
+    return length;
+}
+
+void MultilevelSolver::refine(const std::vector<City> & cities, unsigned int levelSeed, std::vector<int> & tour) const
+{
+    const int m = static_cast<int>(tour.size());
+    const int w = std::min(windowSize, m);
+    const double meanEdge = tourLength(cities, tour) / m;
+    if (w < 5 || meanEdge <= 0)
+    {
+        return;
+    }
+
+    // The temperatures follow the scale of the level
+    AnnealingParameters parameters;
+    parameters.initialTemp = static_cast<float>(refineTemp * meanEdge);
+    parameters.endTemp = 0.01f * parameters.initialTemp;
+    parameters.alpha = static_cast<float>(std::pow(0.01, 1.0 / std::max(1, refineLevels)));
+    parameters.outerLoops = refineLevels;
+    parameters.innerLoops = refineSweeps * w;
+    parameters.batchSize = 64;
+    ParameterizedOptimizer refiner(parameters);
+
+    // Neighboring windows share their end city, which stays in place
+    const int numWindows = (m - 1 + w - 2) / (w - 1);
+    const int shift = std::max(1, (w - 1) / std::max(1, refinePasses));
+    for (int p = 0; p < refinePasses; p++)
+    {
+        if (p > 0)
+        {
+            std::rotate(tour.begin(), tour.begin() + shift, tour.end());
+        }
+        for (int k = 0; k < numWindows; k++)
+        {
+            const int first = k * (w - 1);
+            const int size = std::min(w, m - first);
+            if (size < 5)
+            {
+                continue;
+            }
+            const unsigned int windowSeed = levelSeed != 0 ? levelSeed + static_cast<unsigned int>(p * numWindows + k) : 0;
+            pool.submit([&cities, &refiner, &tour, windowSeed, first, size](int) {
+                refineWindow(cities, refiner, windowSeed, &tour[first], size);
+            });
+        }
+        pool.wait();
+    }
+}
+
+double MultilevelSolver::solve(const TSPInstance & instance, std::vector<int> & result) const
+{
+    const std::vector<City> & cities = instance.getCities();
+    const int n = static_cast<int>(cities.size());
+    if (n < 4)
+    {
+        result.resize(n);
+        for (int i = 0; i < n; i++)
+        {
+            result[i] = i;
+        }
+        return tourLength(cities, result);
+    }
+
+    std::mt19937 generator(seed != 0 ? seed : std::random_device{}());
+
+    // Coarsen until the instance is small enough or the matching stalls
+    std::vector<std::vector<City> > levels(1, cities);
+    std::vector<std::vector<int> > weights(1, std::vector<int>(n, 1));
+    std::vector<std::vector<int> > children;
+    while (static_cast<int>(levels.back().size()) > coarsestSize)
+    {
+        std::vector<City> coarse;
+        std::vector<int> coarseWeights, merged;
+        coarsen(levels.back(), weights.back(), generator, coarse, coarseWeights, merged);
+        if (coarse.size() > 0.95 * levels.back().size())
+        {
+            break;
+        }
+        levels.push_back(std::vector<City>());
+        levels.back().swap(coarse);
+        weights.push_back(std::vector<int>());
+        weights.back().swap(coarseWeights);
+        children.push_back(std::vector<int>());
+        children.back().swap(merged);
+    }
+
+    // Scale the coarsest instance into the square of the prototype
+    const std::vector<City> & coarsest = levels.back();
+    float minX = coarsest[0].first, maxX = minX;
+    float minY = coarsest[0].second, maxY = minY;
+    for (size_t i = 1; i < coarsest.size(); i++)
+    {
+        minX = std::min(minX, coarsest[i].first);
+        maxX = std::max(maxX, coarsest[i].first);
+        minY = std::min(minY, coarsest[i].second);
+        maxY = std::max(maxY, coarsest[i].second);
+    }
+    const float extent = std::max(maxX - minX, maxY - minY);
+    const float scale = extent > 0 ? 1000.0f / extent : 1.0f;
+    std::vector<City> scaled(coarsest.size());
+    for (size_t i = 0; i < coarsest.size(); i++)
+    {
+        scaled[i] = std::make_pair((coarsest[i].first - minX) * scale, (coarsest[i].second - minY) * scale);
+    }
+    TSPInstance coarseInstance;
+    coarseInstance.swapCities(scaled);
+    coarseInstance.calcDistanceMatrix(pool);
+
+    std::vector<int> tour;
+    prototype.optimize(coarseInstance, tour);
+
+    // Expand and refine level by level
+    std::vector<int> fineTour;
+    for (int l = static_cast<int>(levels.size()) - 1; l > 0; l--)
+    {
+        expand(levels[l - 1], children[l - 1], tour, fineTour);
+        tour.swap(fineTour);
+        refine(levels[l - 1], seed != 0 ? seed + 1000003u * static_cast<unsigned int>(l) : 0, tour);
+    }
+
+    result.swap(tour);
+    return tourLength(cities, result);
+}
@@ -0,0 +1,101 @@
+#ifndef MULTILEVEL_H
+#define MULTILEVEL_H
+
+#include <vector>
+
+#include "tsp.h"
+#include "pool.h"
+
+/**
+ * This solver handles instances that are too large for flat annealing. It
+ * coarsens the instance by repeatedly merging every city with its nearest
+ * unmatched neighbor, anneals the coarsest instance with the prototype and
+ * then expands the tour level by level. After every expansion, the tour is
+ * refined by short low-temperature annealing runs on windows of consecutive
+ * cities. The windows of a pass are refined in parallel on the pool.
+ *
+ * Only the coarsest instance and the windows get a distance matrix, so the
+ * memory grows linearly with the number of cities.
+ */
+class MultilevelSolver {
+public:
+    /**
+     * Constructor. The prototype anneals the coarsest instance. Its
+     * parameters are meant for cities in a 1000x1000 square, hence the
+     * coarsest instance is scaled into that square.
+     */
+    MultilevelSolver(const Optimizer & prototype, WorkerPool & pool) :
+            coarsestSize(500),
+            windowSize(100),
+            refinePasses(3),
+            refineLevels(10),
+            refineSweeps(20),
+            refineTemp(0.5f),
+            seed(0),
+            prototype(prototype),
+            pool(pool) {}
+
+    /**
+     * The coarsening stops once the instance has at most this many cities
+     */
+    int coarsestSize;
+    /**
+     * The number of cities per refinement window, including the two cities
+     * at its ends that stay in place
+     */
+    int windowSize;
+    /**
+     * The number of refinement passes per level. Every pass shifts the
+     * windows, such that their borders are refined as well
+     */
+    int refinePasses;
+    /**
+     * The number of temperature levels of a refinement run
+     */
+    int refineLevels;
+    /**
+     * The number of proposals per city of the window and temperature level
+     */
+    int refineSweeps;
+    /**
+     * The initial temperature of the refinement runs relative to the mean
+     * edge length of the tour
+     */
+    float refineTemp;
+    /**
+     * The seed of the matching order and the refinement runs. Set to 0 for a
+     * random seed
+     */
+    unsigned int seed;
+
+    /**
+     * Solves an instance. Its distance matrix does not have to be set up.
+     * Returns the tour length
+     */
+    double solve(const TSPInstance & instance, std::vector<int> & result) const;
+
+    /**
+     * Computes the length of a tour from the coordinates of its cities
+     */
+    static double tourLength(const std::vector<City> & cities, const std::vector<int> & tour);
+
+private:
+    MultilevelSolver(const MultilevelSolver &);
+    MultilevelSolver & operator=(const MultilevelSolver &);
+
+    /**
+     * Refines a tour with low-temperature annealing runs on windows
+     */
+    void refine(const std::vector<City> & cities, unsigned int levelSeed, std::vector<int> & tour) const;
+
+    /**
+     * The optimizer of the coarsest instance
+     */
+    const Optimizer & prototype;
+    /**
+     * The worker pool
+     */
+    WorkerPool & pool;
+};
+
+#endif
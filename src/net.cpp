@@ -0,0 +1,295 @@
+#include "net.h"
+
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+/// SocketConnection
+////////////////////////////////////////////////////////////////////////////////
+
+SocketConnection::~SocketConnection()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+bool SocketConnection::fill()
+{
+    // Drop the consumed part of the buffer
+    if (offset > 0)
+    {
+        buffer.erase(0, offset);
+        offset = 0;
+    }
+
+    char chunk[65536];
+    while (true)
+    {
+        const ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+        if (received > 0)
+        {
+            buffer.append(chunk, static_cast<size_t>(received));
+            return true;
+        }
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        return false;
+    }
+}
+
+bool SocketConnection::readLine(std::string & line)
+{
+    while (true)
+    {
+        const size_t end = buffer.find('\n', offset);
+        if (end != std::string::npos)
+        {
+            line.assign(buffer, offset, end - offset);
+            offset = end + 1;
+            // Accept Windows line breaks
+            if (!line.empty() && line[line.size() - 1] == '\r')
+            {
+                line.erase(line.size() - 1);
+            }
+            return true;
+        }
+        if (!fill())
+        {
+            return false;
+        }
+    }
+}
+
+bool SocketConnection::read(char* data, size_t size)
+{
+    while (buffer.size() - offset < size)
+    {
+        if (!fill())
+        {
+            return false;
+        }
+    }
+    std::memcpy(data, buffer.data() + offset, size);
+    offset += size;
+    return true;
+}
+
+bool SocketConnection::write(const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        // Do not raise SIGPIPE if the peer has gone away
+        const ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool SocketConnection::poll(int timeout)
+{
+    if (offset < buffer.size())
+    {
+        return true;
+    }
+    struct pollfd request;
+    request.fd = fd;
+    request.events = POLLIN;
+    request.revents = 0;
+    return ::poll(&request, 1, timeout) > 0;
+}
+
+void SocketConnection::shutdown()
+{
+    ::shutdown(fd, SHUT_RDWR);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Unix domain sockets
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Fills in the address of a Unix domain socket. Returns false if the path is
+ * too long.
+ */
+static bool unixAddress(const std::string & path, struct sockaddr_un & address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    return true;
+}
+
+int listenUnixSocket(const std::string & path, unsigned long long* inode)
+{
+    struct sockaddr_un address;
+    if (!unixAddress(path, address))
+    {
+        return -1;
+    }
+
+    // Remove a stale socket file of a previous run. Any other file at the
+    // path, and the socket of a running process, is left alone
+    struct stat status;
+    if (lstat(path.c_str(), &status) == 0)
+    {
+        if (!S_ISSOCK(status.st_mode))
+        {
+            errno = EEXIST;
+            return -1;
+        }
+        const int probe = connectUnixSocket(path);
+        if (probe >= 0)
+        {
+            close(probe);
+            errno = EADDRINUSE;
+            return -1;
+        }
+        unlink(path.c_str());
+    }
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0 ||
+            listen(fd, SOMAXCONN) < 0)
+    {
+        const int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    if (inode != 0)
+    {
+        *inode = lstat(path.c_str(), &status) == 0 ? status.st_ino : 0;
+    }
+    return fd;
+}
+
+bool removeUnixSocket(const std::string & path, unsigned long long inode)
+{
+    // The file has to be the socket that has been created by
+    // listenUnixSocket, not a socket or file that replaced it in the meantime
+    struct stat status;
+    if (lstat(path.c_str(), &status) != 0 || !S_ISSOCK(status.st_mode) ||
+            status.st_ino != inode)
+    {
+        return false;
+    }
+    return unlink(path.c_str()) == 0;
+}
+
+int connectUnixSocket(const std::string & path)
+{
+    struct sockaddr_un address;
+    if (!unixAddress(path, address))
+    {
+        return -1;
+    }
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// TCP sockets
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Creates a TCP socket that is bound to or connected to a host and port.
+ * Returns -1 on error.
+ */
+static int tcpSocket(const std::string & host, int port, bool server)
+{
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = server ? AI_PASSIVE : 0;
+
+    struct addrinfo* addresses = 0;
+    const std::string service = std::to_string(port);
+    if (getaddrinfo(host.empty() ? 0 : host.c_str(), service.c_str(), &hints, &addresses) != 0)
+    {
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo* a = addresses; a != 0 && fd < 0; a = a->ai_next)
+    {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        const int one = 1;
+        bool success;
+        if (server)
+        {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            success = bind(fd, a->ai_addr, a->ai_addrlen) == 0 && listen(fd, SOMAXCONN) == 0;
+        }
+        else
+        {
+            success = connect(fd, a->ai_addr, a->ai_addrlen) == 0;
+        }
+        if (!success)
+        {
+            close(fd);
+            fd = -1;
+            continue;
+        }
+
+        // Small messages must not wait for more data
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    freeaddrinfo(addresses);
+    return fd;
+}
+
+int listenTcpSocket(const std::string & host, int port)
+{
+    return tcpSocket(host, port, true);
+}
+
+int connectTcpSocket(const std::string & host, int port)
+{
+    return tcpSocket(host, port, false);
+}
@@ -0,0 +1,113 @@
+#ifndef NET_H
+#define NET_H
+
+#include <string>
+
+/**
+ * This is a buffered, blocking connection on top of a socket. The connection
+ * owns the socket and closes it when it is destroyed.
+ */
+class SocketConnection {
+public:
+    /**
+     * Constructor
+     */
+    SocketConnection(int fd) : fd(fd), offset(0) {}
+
+    /**
+     * Destructor
+     */
+    ~SocketConnection();
+
+    /**
+     * Reads a single line without the line break. Returns false if the
+     * connection has been closed before a full line arrived.
+     */
+    bool readLine(std::string & line);
+
+    /**
+     * Reads exactly size bytes. Returns false if the connection has been
+     * closed before.
+     */
+    bool read(char* data, size_t size);
+
+    /**
+     * Writes all bytes. Returns false on error.
+     */
+    bool write(const char* data, size_t size);
+
+    /**
+     * Writes a string. Returns false on error.
+     */
+    bool write(const std::string & data)
+    {
+        return write(data.data(), data.size());
+    }
+
+    /**
+     * Waits until data can be read without blocking or the timeout in 
+     * milliseconds expires. Returns true if data is available.
+     */
+    bool poll(int timeout);
+
+    /**
+     * Shuts the connection down such that blocking reads return
+     */
+    void shutdown();
+
+private:
+    SocketConnection(const SocketConnection &);
+    SocketConnection & operator=(const SocketConnection &);
+
+    /**
+     * Reads more data into the buffer. Returns false if the connection has
+     * been closed.
+     */
+    bool fill();
+
+    /**
+     * The socket
+     */
+    int fd;
+    /**
+     * Data that has been received but not consumed yet
+     */
+    std::string buffer;
+    /**
+     * The position of the first unconsumed byte in the buffer
+     */
+    size_t offset;
+};
+
+/**
+ * Creates a Unix domain socket that listens on a path. A stale socket file at
+ * the path is replaced. Returns -1 on error, with errno set to EEXIST if the
+ * path is taken by a file that is not a socket and to EADDRINUSE if another
+ * process listens on it. The inode of the created socket file is stored in
+ * inode unless it is null.
+ */
+int listenUnixSocket(const std::string & path, unsigned long long* inode = 0);
+
+/**
+ * Removes the socket file that has been created by listenUnixSocket. Nothing
+ * is removed if the path now refers to a different file. Returns true if the
+ * file has been removed.
+ */
+bool removeUnixSocket(const std::string & path, unsigned long long inode);
+
+/**
+ * Connects to a Unix domain socket. Returns -1 on error.
+ */
+int connectUnixSocket(const std::string & path);
+
+/**
+ * Creates a TCP socket that listens on a host and port. Returns -1 on error.
+ */
+int listenTcpSocket(const std::string & host, int port);
+
+/**
+ * Connects to a TCP socket. Returns -1 on error.
+ */
+int connectTcpSocket(const std::string & host, int port);
+
+#endif
@@ -0,0 +1,311 @@
+#include "parallel.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// OptimizerClone
+////////////////////////////////////////////////////////////////////////////////
+
+OptimizerClone::OptimizerClone(const Optimizer & prototype, bool withObservers)
+{
+    coolingSchedule = prototype.coolingSchedule;
+    outerLoops = prototype.outerLoops;
+    innerLoops = prototype.innerLoops;
+    notificationCycle = prototype.notificationCycle;
+    localSearch = prototype.localSearch;
+    localSearchEachLevel = prototype.localSearchEachLevel;
+    timeLimit = prototype.timeLimit;
+    batchSize = prototype.batchSize;
+    batchAcceptance = prototype.batchAcceptance;
+    tracer = prototype.tracer;
+    seed = prototype.seed;
+
+    for (size_t i = 0; i < prototype.getMoves().size(); i++)
+    {
+        ownedMoves.push_back(prototype.getMoves()[i]->clone());
+        addMove(ownedMoves.back());
+    }
+    if (withObservers)
+    {
+        for (size_t i = 0; i < prototype.getObservers().size(); i++)
+        {
+            addObserver(prototype.getObservers()[i]);
+        }
+    }
+}
+
+OptimizerClone::~OptimizerClone()
+{
+    for (size_t i = 0; i < ownedMoves.size(); i++)
+    {
+        DELETE_PTR(ownedMoves[i]);
+    }
+}
+
+void runChains(const Optimizer & prototype, int numChains, const TSPInstance & instance,
+        const std::function<void(int, Optimizer &, std::vector<int> &)> & chain,
+        std::vector<int> & result)
+{
+    assert(numChains > 0);
+
+    std::vector<std::vector<int> > results(numChains);
+    std::vector<std::thread> threads;
+
+    for (int c = 0; c < numChains; c++)
+    {
+        threads.push_back(std::thread([&prototype, c, &chain, &results]() {
+            // Set up a private optimizer. The chains must not share a seed
+            OptimizerClone optimizer(prototype, c == 0);
+            optimizer.seed = prototype.seed != 0 ? prototype.seed + c : 0;
+            chain(c, optimizer, results[c]);
+        }));
+    }
+
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+
+    // Pick the best chain
+    int best = 0;
+    float bestEnergy = instance.calcTourLength(results[0]);
+    for (int c = 1; c < numChains; c++)
+    {
+        const float energy = instance.calcTourLength(results[c]);
+        if (energy < bestEnergy)
+        {
+            bestEnergy = energy;
+            best = c;
+        }
+    }
+    result = results[best];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// BestTourBoard
+////////////////////////////////////////////////////////////////////////////////
+
+BestTourBoard::BestTourBoard(int numCities, int numSlots) :
+        slots(numSlots),
+        current(0),
+        lastVersion(0)
+{
+    assert(numSlots > 0 && numSlots < (1 << indexBits));
+
+    // Preallocate all snapshots such that publishing never allocates
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        slots[i].tour.resize(numCities);
+    }
+}
+
+bool BestTourBoard::publish(const std::vector<int> & tour, float energy)
+{
+    // Cheap early out for tours that cannot improve the board
+    if (energy >= bestEnergy())
+    {
+        return false;
+    }
+
+    // Grab a free slot
+    int slot = -1;
+    for (int i = 0; i < static_cast<int>(slots.size()); i++)
+    {
+        int expected = 0;
+        if (slots[i].refs.compare_exchange_strong(expected, -1, std::memory_order_acquire))
+        {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0)
+    {
+        // All slots are in use. The caller will try again later
+        return false;
+    }
+
+    // Fill the snapshot
+    Snapshot & s = slots[slot];
+    const uint64_t version = lastVersion.fetch_add(1, std::memory_order_relaxed) + 1;
+    s.tour = tour;
+    s.energy.store(energy, std::memory_order_relaxed);
+    s.version.store(version, std::memory_order_relaxed);
+    // This reference is owned by the board
+    s.refs.store(1, std::memory_order_release);
+
+    // Install the snapshot unless somebody else has been faster with a better
+    // tour
+    const uint64_t word = (version << indexBits) | static_cast<uint64_t>(slot);
+    uint64_t old = current.load(std::memory_order_acquire);
+    while (true)
+    {
+        // If the slot has been recycled in the meantime, then the version has
+        // changed and the exchange below fails
+        if (old != 0 && slots[old & ((1 << indexBits) - 1)].energy.load(std::memory_order_relaxed) <= energy)
+        {
+            release(slot);
+            return false;
+        }
+        if (current.compare_exchange_weak(old, word, std::memory_order_acq_rel))
+        {
+            break;
+        }
+    }
+
+    // Drop the board's reference to the previous snapshot
+    if (old != 0)
+    {
+        release(static_cast<int>(old & ((1 << indexBits) - 1)));
+    }
+    return true;
+}
+
+uint64_t BestTourBoard::read(std::vector<int> & tour, float & energy)
+{
+    while (true)
+    {
+        const uint64_t word = current.load(std::memory_order_acquire);
+        if (word == 0)
+        {
+            return 0;
+        }
+
+        // Acquire a reference unless the slot is free or being written
+        Snapshot & s = slots[word & ((1 << indexBits) - 1)];
+        int refs = s.refs.load(std::memory_order_relaxed);
+        bool acquired = false;
+        while (refs > 0)
+        {
+            if (s.refs.compare_exchange_weak(refs, refs + 1, std::memory_order_acquire))
+            {
+                acquired = true;
+                break;
+            }
+        }
+        if (!acquired)
+        {
+            continue;
+        }
+
+        // The slot cannot change while we hold the reference. Make sure it
+        // still holds the snapshot we were looking for
+        const uint64_t version = word >> indexBits;
+        if (s.version.load(std::memory_order_relaxed) == version)
+        {
+            tour = s.tour;
+            energy = s.energy.load(std::memory_order_relaxed);
+            s.refs.fetch_sub(1, std::memory_order_release);
+            return version;
+        }
+        s.refs.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+float BestTourBoard::bestEnergy() const
+{
+    const uint64_t word = current.load(std::memory_order_acquire);
+    if (word == 0)
+    {
+        return std::numeric_limits<float>::max();
+    }
+    return slots[word & ((1 << indexBits) - 1)].energy.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// CooperativeOptimizer
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * This hook connects a single chain to the board
+ */
+class MigrationHook : public Optimizer::LevelHook {
+public:
+    /**
+     * Constructor
+     */
+    MigrationHook(BestTourBoard & board, const MigrationPolicy* policy) :
+            board(board),
+            policy(policy),
+            published(std::numeric_limits<float>::max()),
+            adopted(0) {}
+
+    /**
+     * Publishes improvements and migrates if the chain is lagging behind
+     */
+    virtual void levelFinished(const TSPInstance & instance, Optimizer::Config & config)
+    {
+        // Publish the best tour of this chain if it improved
+        if (config.bestEnergy < published)
+        {
+            if (board.publish(config.bestState, config.bestEnergy) ||
+                    board.bestEnergy() <= config.bestEnergy)
+            {
+                published = config.bestEnergy;
+            }
+        }
+
+        if (policy == 0 || !policy->shouldMigrate(config, board.bestEnergy()))
+        {
+            return;
+        }
+
+        // Do not adopt the same snapshot twice
+        if (board.version() == adopted)
+        {
+            return;
+        }
+
+        float energy;
+        adopted = board.read(tour, energy);
+        if (adopted == 0)
+        {
+            return;
+        }
+        config.state = tour;
+        config.energy = instance.calcTourLength(config.state);
+        if (config.energy < config.bestEnergy)
+        {
+            config.bestEnergy = config.energy;
+            config.bestState = config.state;
+            published = config.bestEnergy;
+        }
+    }
+
+private:
+    /**
+     * The shared board
+     */
+    BestTourBoard & board;
+    /**
+     * The migration policy
+     */
+    const MigrationPolicy* policy;
+    /**
+     * The best energy this chain has published
+     */
+    float published;
+    /**
+     * The version of the snapshot this chain adopted last
+     */
+    uint64_t adopted;
+    /**
+     * Buffer for adopted tours
+     */
+    std::vector<int> tour;
+};
+
+void CooperativeOptimizer::optimize(const TSPInstance & instance, std::vector<int> & result) const
+{
+    const int n = static_cast<int>(instance.getCities().size());
+
+    // Every chain may hold one slot for reading and one for writing
+    BestTourBoard board(n, 2 * numChains + 1);
+    optimize(instance, board, result);
+}
+
+void CooperativeOptimizer::optimize(const TSPInstance & instance, BestTourBoard & board, std::vector<int> & result) const
+{
+    runChains(prototype, numChains, instance, [this, &board, &instance](int, Optimizer & chain, std::vector<int> & tour) {
+        MigrationHook hook(board, migrationPolicy);
+        chain.addLevelHook(&hook);
+        chain.optimize(instance, tour);
+    }, result);
+}
@@ -0,0 +1,237 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "tsp.h"
+
+/**
+ * This is an optimizer that copies the parameters of a prototype. It owns
+ * private copies of the prototype's moves, because the moves hold the move
+ * service. Hence, several clones can run in parallel.
+ */
+class OptimizerClone : public Optimizer {
+public:
+    /**
+     * Constructor. The observers of the prototype are only attached if
+     * requested.
+     */
+    OptimizerClone(const Optimizer & prototype, bool withObservers);
+
+    /**
+     * Destructor
+     */
+    ~OptimizerClone();
+
+private:
+    OptimizerClone(const OptimizerClone &);
+    OptimizerClone & operator=(const OptimizerClone &);
+
+    /**
+     * The cloned moves
+     */
+    std::vector<Optimizer::Move*> ownedMoves;
+};
+
+/**
+ * Runs numChains clones of the prototype on their own threads and stores the
+ * shortest of their tours in result. The chains get consecutive seeds unless
+ * the seed of the prototype is 0, and the observers are only attached to the
+ * first chain. The function is called on the thread of every chain with the
+ * index of the chain, its optimizer and its tour. It may add level hooks and
+ * has to run the optimizer.
+ */
+void runChains(const Optimizer & prototype, int numChains, const TSPInstance & instance,
+        const std::function<void(int, Optimizer &, std::vector<int> &)> & chain,
+        std::vector<int> & result);
+
+/**
+ * This is a lock-free board that holds the best tour found by any of several
+ * parallel chains. Every published tour becomes a new immutable snapshot with
+ * a unique, increasing version number.
+ *
+ * The snapshots live in a fixed pool of preallocated slots. A slot is recycled
+ * only once neither the board nor any reader references it anymore, so neither
+ * publishing nor reading ever allocates or blocks.
+ */
+class BestTourBoard {
+public:
+    /**
+     * Constructor
+     */
+    BestTourBoard(int numCities, int numSlots);
+
+    /**
+     * Publishes a tour. The tour only replaces the current snapshot if it is
+     * strictly shorter. Returns true if the tour has been installed.
+     */
+    bool publish(const std::vector<int> & tour, float energy);
+
+    /**
+     * Copies the current snapshot. Returns its version or 0 if nothing has
+     * been published yet.
+     */
+    uint64_t read(std::vector<int> & tour, float & energy);
+
+    /**
+     * Returns the energy of the current snapshot
+     */
+    float bestEnergy() const;
+
+    /**
+     * Returns the version of the current snapshot
+     */
+    uint64_t version() const
+    {
+        return current.load(std::memory_order_acquire) >> indexBits;
+    }
+
+private:
+    /**
+     * A single snapshot of the board
+     */
+    class Snapshot {
+    public:
+        Snapshot() : refs(0), version(0), energy(0) {}
+        /**
+         * The number of references. -1 indicates that a writer owns the slot
+         */
+        std::atomic<int> refs;
+        /**
+         * The version of the snapshot
+         */
+        std::atomic<uint64_t> version;
+        /**
+         * The length of the tour
+         */
+        std::atomic<float> energy;
+        /**
+         * The tour
+         */
+        std::vector<int> tour;
+    };
+
+    /**
+     * The number of bits of the current word that encode the slot index
+     */
+    static const int indexBits = 16;
+
+    /**
+     * Releases a single reference to a slot
+     */
+    void release(int slot)
+    {
+        slots[slot].refs.fetch_sub(1, std::memory_order_release);
+    }
+
+    /**
+     * The snapshot pool
+     */
+    std::vector<Snapshot> slots;
+    /**
+     * The current snapshot as (version << indexBits) | slot. 0 means empty.
+     */
+    std::atomic<uint64_t> current;
+    /**
+     * The last version that has been handed out
+     */
+    std::atomic<uint64_t> lastVersion;
+};
+
+/**
+ * A migration policy decides when a chain gives up its current state and
+ * adopts the global best tour.
+ */
+class MigrationPolicy {
+public:
+    /**
+     * Returns true if the chain should adopt the global best tour at the end
+     * of the current temperature level
+     */
+    virtual bool shouldMigrate(const Optimizer::Config & config, float globalBest) const = 0;
+};
+
+/**
+ * This policy lets a chain migrate every few temperature levels if its current
+ * energy is more than a relative gap above the global best.
+ */
+class GapMigrationPolicy : public MigrationPolicy {
+public:
+    /**
+     * Constructor
+     */
+    GapMigrationPolicy(int interval, float gap) : interval(interval), gap(gap) {}
+
+    /**
+     * Returns true if the chain should adopt the global best tour
+     */
+    virtual bool shouldMigrate(const Optimizer::Config & config, float globalBest) const
+    {
+        if (interval <= 0 || (config.outer + 1) % interval != 0)
+        {
+            return false;
+        }
+        return config.energy > globalBest * (1 + gap);
+    }
+
+private:
+    /**
+     * The number of temperature levels between two migrations
+     */
+    int interval;
+    /**
+     * The relative gap to the global best that triggers a migration
+     */
+    float gap;
+};
+
+/**
+ * This optimizer runs several annealing chains in parallel. The chains
+ * publish their best tours to a shared board and lagging chains adopt the
+ * global best according to a migration policy. Without a migration policy,
+ * the chains are fully independent (multi-start).
+ */
+class CooperativeOptimizer {
+public:
+    /**
+     * Constructor. Every chain copies the parameters and moves of the
+     * prototype. The observers are only attached to the first chain.
+     */
+    CooperativeOptimizer(const Optimizer & prototype) :
+            numChains(std::max(1u, std::thread::hardware_concurrency())),
+            migrationPolicy(0),
+            prototype(prototype) {}
+
+    /**
+     * The number of parallel chains
+     */
+    int numChains;
+    /**
+     * The migration policy. Set to 0 for independent chains
+     */
+    MigrationPolicy* migrationPolicy;
+
+    /**
+     * Runs the chains on a specific problem instance
+     */
+    void optimize(const TSPInstance & instance, std::vector<int> & result) const;
+
+    /**
+     * Runs the chains on a board that may also be accessed from outside, 
+     * e.g. in order to exchange tours with other processes. The board must 
+     * have 2 * numChains + 1 slots for the chains
+     */
+    void optimize(const TSPInstance & instance, BestTourBoard & board, std::vector<int> & result) const;
+
+private:
+    /**
+     * The optimizer whose configuration is used by every chain
+     */
+    const Optimizer & prototype;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "pool.h"
+
+#include <cassert>
+
+////////////////////////////////////////////////////////////////////////////////
+/// WorkerPool
+////////////////////////////////////////////////////////////////////////////////
+
+WorkerPool::WorkerPool(int numWorkers) : pending(0), stopped(false)
+{
+    assert(numWorkers > 0);
+
+    for (int i = 0; i < numWorkers; i++)
+    {
+        threads.push_back(std::thread(&WorkerPool::run, this, i));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+    }
+    taskAvailable.notify_all();
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+}
+
+void WorkerPool::submit(const Task & task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(task);
+        pending++;
+    }
+    taskAvailable.notify_one();
+}
+
+void WorkerPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    taskFinished.wait(lock, [this]() { return pending == 0; });
+}
+
+void WorkerPool::run(int worker)
+{
+    while (true)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this]() { return stopped || !queue.empty(); });
+            if (queue.empty())
+            {
+                // We have been stopped
+                return;
+            }
+            task = queue.front();
+            queue.pop_front();
+        }
+
+        task(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending--;
+        }
+        taskFinished.notify_all();
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * This is a simple pool of worker threads. Tasks are executed in the order in
+ * which they are submitted. Every task receives the index of the worker that
+ * runs it, such that tasks can reuse per-worker buffers.
+ */
+class WorkerPool {
+public:
+    /**
+     * A task. The argument is the index of the worker
+     */
+    typedef std::function<void(int)> Task;
+
+    /**
+     * Constructor. Starts the worker threads
+     */
+    WorkerPool(int numWorkers);
+
+    /**
+     * Destructor. Finishes all submitted tasks and stops the workers
+     */
+    ~WorkerPool();
+
+    /**
+     * Submits a task
+     */
+    void submit(const Task & task);
+
+    /**
+     * Blocks until all submitted tasks have finished
+     */
+    void wait();
+
+    /**
+     * Returns the number of workers
+     */
+    int size() const
+    {
+        return static_cast<int>(threads.size());
+    }
+
+private:
+    WorkerPool(const WorkerPool &);
+    WorkerPool & operator=(const WorkerPool &);
+
+    /**
+     * The main loop of a single worker
+     */
+    void run(int worker);
+
+    /**
+     * The worker threads
+     */
+    std::vector<std::thread> threads;
+    /**
+     * The tasks that have not been started yet
+     */
+    std::deque<Task> queue;
+    /**
+     * The number of submitted tasks that have not finished yet
+     */
+    int pending;
+    /**
+     * Whether or not the workers shall stop
+     */
+    bool stopped;
+    /**
+     * Protects the queue and the counters
+     */
+    std::mutex mutex;
+    /**
+     * Signals new tasks to the workers
+     */
+    std::condition_variable taskAvailable;
+    /**
+     * Signals finished tasks to waiting threads
+     */
+    std::condition_variable taskFinished;
+};
+
+#endif
@@ -0,0 +1,351 @@
+#include "population.h"
+#include "parallel.h"
+#include <condition_variable>
+#include <mutex>
+
+////////////////////////////////////////////////////////////////////////////////
+/// PartitionCrossover
+////////////////////////////////////////////////////////////////////////////////
+
+bool PartitionCrossover::recombine(const TSPInstance & instance, const std::vector<int> & parentA, const std::vector<int> & parentB, std::vector<int> & child) const
+{
+    const int n = static_cast<int>(parentA.size());
+    if (n < 4 || static_cast<int>(parentB.size()) != n)
+    {
+        return false;
+    }
+
+    // Let A be the shorter parent
+    const bool swapped = instance.calcTourLength(parentB) < instance.calcTourLength(parentA);
+    const std::vector<int> & A = swapped ? parentB : parentA;
+    const std::vector<int> & B = swapped ? parentA : parentB;
+
+    // The tour neighbors of every city in both parents
+    std::vector<int> succA(n), predA(n), succB(n), predB(n);
+    for (int i = 0; i < n; i++)
+    {
+        const int j = i + 1 == n ? 0 : i + 1;
+        succA[A[i]] = A[j];
+        predA[A[j]] = A[i];
+        succB[B[i]] = B[j];
+        predB[B[j]] = B[i];
+    }
+    auto inA = [&succA, &predA](int u, int v) {
+        return succA[u] == v || predA[u] == v;
+    };
+    auto inB = [&succB, &predB](int u, int v) {
+        return succB[u] == v || predB[u] == v;
+    };
+
+    // Label the connected components of the union graph without the common
+    // edges. Cities whose edges are all common do not belong to a component
+    std::vector<int> component(n, -1);
+    std::vector<int> stack;
+    int numComponents = 0;
+    for (int s = 0; s < n; s++)
+    {
+        if (component[s] >= 0 || (inB(s, succA[s]) && inB(s, predA[s])))
+        {
+            continue;
+        }
+
+        component[s] = numComponents;
+        stack.push_back(s);
+        while (!stack.empty())
+        {
+            const int v = stack.back();
+            stack.pop_back();
+
+            const int neighbors[4] = {succA[v], predA[v], succB[v], predB[v]};
+            for (int k = 0; k < 4; k++)
+            {
+                const int u = neighbors[k];
+                const bool common = k < 2 ? inB(v, u) : inA(v, u);
+                if (!common && component[u] < 0)
+                {
+                    component[u] = numComponents;
+                    stack.push_back(u);
+                }
+            }
+        }
+        numComponents++;
+    }
+
+    // Count the common edges that leave every component and sum up the
+    // remaining edges of both parents inside of it
+    std::vector<int> portals(numComponents, 0);
+    std::vector<float> lengthA(numComponents, 0), lengthB(numComponents, 0);
+    for (int v = 0; v < n; v++)
+    {
+        const int c = component[v];
+        if (c < 0)
+        {
+            continue;
+        }
+        if (component[succA[v]] != c)
+        {
+            portals[c]++;
+        }
+        if (component[predA[v]] != c)
+        {
+            portals[c]++;
+        }
+        if (!inB(v, succA[v]))
+        {
+            lengthA[c] += instance.dist(v, succA[v]);
+        }
+        if (!inA(v, succB[v]))
+        {
+            lengthB[c] += instance.dist(v, succB[v]);
+        }
+    }
+
+    // Take the path of B wherever it is shorter and the component is entered
+    // exactly once
+    std::vector<char> useB(numComponents, 0);
+    bool changed = false;
+    for (int c = 0; c < numComponents; c++)
+    {
+        useB[c] = portals[c] == 2 && lengthB[c] < lengthA[c];
+        changed = changed || useB[c];
+    }
+    if (!changed)
+    {
+        child = A;
+        std::rotate(child.begin(), std::find(child.begin(), child.end(), parentA[0]), child.end());
+        return true;
+    }
+
+    // Walk along the offspring starting at the first city of parent A
+    std::vector<char> visited(n, 0);
+    child.resize(n);
+    int prev = -1;
+    int current = parentA[0];
+    for (int i = 0; i < n; i++)
+    {
+        if (visited[current])
+        {
+            return false;
+        }
+        visited[current] = 1;
+        child[i] = current;
+
+        const bool b = component[current] >= 0 && useB[component[current]];
+        const int first = b ? succB[current] : succA[current];
+        const int second = b ? predB[current] : predA[current];
+        const int next = first != prev ? first : second;
+        prev = current;
+        current = next;
+    }
+    return current == parentA[0];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// PopulationOptimizer
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The population is the meeting point of the chains. The last chain that
+ * arrives at an epoch recombines the tours while the others wait.
+ */
+class Population {
+public:
+    /**
+     * Constructor
+     */
+    Population(const TSPInstance & instance, const Crossover & crossover, int numChains) :
+            instance(instance),
+            crossover(crossover),
+            active(numChains),
+            arrived(0),
+            generation(0),
+            tours(numChains),
+            energies(numChains),
+            present(numChains, 0),
+            replaced(numChains, 0) {}
+
+    /**
+     * Hands in the current state of a chain and waits for the other chains.
+     * If the chain has been replaced, then its state is set to the offspring.
+     */
+    void exchange(int chain, Optimizer::Config & config)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        tours[chain] = config.state;
+        energies[chain] = config.energy;
+        present[chain] = 1;
+        replaced[chain] = 0;
+        arrived++;
+
+        if (arrived == active)
+        {
+            recombine();
+        }
+        else
+        {
+            const int g = generation;
+            condition.wait(lock, [this, g]() { return generation != g; });
+        }
+
+        if (replaced[chain])
+        {
+            config.state = tours[chain];
+            config.energy = energies[chain];
+            if (config.energy < config.bestEnergy)
+            {
+                config.bestEnergy = config.energy;
+                config.bestState = config.state;
+            }
+        }
+    }
+
+    /**
+     * Removes a chain that has finished. The remaining chains do not wait for
+     * it anymore.
+     */
+    void leave()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        active--;
+        if (arrived > 0 && arrived == active)
+        {
+            recombine();
+        }
+    }
+
+private:
+    /**
+     * Replaces the weaker half of the present chains by offspring. The lock
+     * must be held.
+     */
+    void recombine()
+    {
+        // Rank the chains by their energy
+        std::vector<int> ranking;
+        for (size_t c = 0; c < present.size(); c++)
+        {
+            if (present[c])
+            {
+                ranking.push_back(static_cast<int>(c));
+            }
+            present[c] = 0;
+        }
+        std::sort(ranking.begin(), ranking.end(), [this](int a, int b) {
+            return energies[a] < energies[b];
+        });
+
+        // Every weak chain is crossed with a different strong chain
+        const int strong = (static_cast<int>(ranking.size()) + 1) / 2;
+        for (int r = strong; r < static_cast<int>(ranking.size()); r++)
+        {
+            const int weak = ranking[r];
+            if (!crossover.recombine(instance, tours[ranking[r - strong]], tours[weak], child))
+            {
+                continue;
+            }
+            const float energy = instance.calcTourLength(child);
+            if (energy < energies[weak])
+            {
+                tours[weak] = child;
+                energies[weak] = energy;
+                replaced[weak] = 1;
+            }
+        }
+
+        arrived = 0;
+        generation++;
+        condition.notify_all();
+    }
+
+    /**
+     * The instance
+     */
+    const TSPInstance & instance;
+    /**
+     * The crossover operator
+     */
+    const Crossover & crossover;
+    /**
+     * Synchronization
+     */
+    std::mutex mutex;
+    std::condition_variable condition;
+    /**
+     * The number of chains that are still running
+     */
+    int active;
+    /**
+     * The number of chains that wait at the current epoch
+     */
+    int arrived;
+    /**
+     * The number of epochs so far
+     */
+    int generation;
+    /**
+     * The states and energies the chains handed in
+     */
+    std::vector<std::vector<int> > tours;
+    std::vector<float> energies;
+    /**
+     * Flags for the chains that are waiting and for the replaced ones
+     */
+    std::vector<char> present;
+    std::vector<char> replaced;
+    /**
+     * Buffer for the offspring
+     */
+    std::vector<int> child;
+};
+
+/**
+ * This hook connects a single chain to the population
+ */
+class RecombinationHook : public Optimizer::LevelHook {
+public:
+    /**
+     * Constructor
+     */
+    RecombinationHook(Population & population, int chain, int interval) :
+            population(population),
+            chain(chain),
+            interval(interval) {}
+
+    /**
+     * Meets the other chains at the end of every epoch
+     */
+    virtual void levelFinished(const TSPInstance &, Optimizer::Config & config)
+    {
+        if (interval > 0 && (config.outer + 1) % interval == 0)
+        {
+            population.exchange(chain, config);
+        }
+    }
+
+private:
+    /**
+     * The population
+     */
+    Population & population;
+    /**
+     * The index of the chain
+     */
+    int chain;
+    /**
+     * The number of temperature levels between two recombinations
+     */
+    int interval;
+};
+
+void PopulationOptimizer::optimize(const TSPInstance & instance, std::vector<int> & result) const
+{
+    assert(numChains > 0);
+
+    Population population(instance, crossover, numChains);
+    runChains(prototype, numChains, instance, [this, &population, &instance](int c, Optimizer & chain, std::vector<int> & tour) {
+        RecombinationHook hook(population, c, interval);
+        chain.addLevelHook(&hook);
+        chain.optimize(instance, tour);
+        population.leave();
+    }, result);
+}
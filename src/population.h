@@ -0,0 +1,82 @@
+#ifndef POPULATION_H
+#define POPULATION_H
+
+#include <thread>
+#include <vector>
+
+#include "tsp.h"
+
+/**
+ * A crossover combines two parent tours into an offspring tour
+ */
+class Crossover {
+public:
+    /**
+     * Computes the offspring of two parents. Returns false if the parents
+     * cannot be recombined.
+     */
+    virtual bool recombine(const TSPInstance & instance, const std::vector<int> & parentA, const std::vector<int> & parentB, std::vector<int> & child) const = 0;
+};
+
+/**
+ * This is a generalized partition crossover (GPX). The union of both parent
+ * tours without their common edges falls apart into connected components.
+ * Every component that both parents enter and leave exactly once through
+ * common edges is covered by a single path in either parent, and both paths
+ * connect the same two cities. Hence, the shorter path can be picked
+ * independently for every such component. All other components are taken
+ * from the shorter parent, so the offspring is never longer than the better
+ * parent. Runs in O(n).
+ */
+class PartitionCrossover : public Crossover {
+public:
+    /**
+     * Computes the offspring of two parents
+     */
+    virtual bool recombine(const TSPInstance & instance, const std::vector<int> & parentA, const std::vector<int> & parentB, std::vector<int> & child) const;
+};
+
+/**
+ * This optimizer runs a population of annealing chains in parallel. Every few
+ * temperature levels, the chains wait for each other. The weaker half of the
+ * population is then replaced by the offspring of the stronger chains if the
+ * offspring is shorter, and all chains continue annealing.
+ */
+class PopulationOptimizer {
+public:
+    /**
+     * Constructor. Every chain copies the parameters and moves of the
+     * prototype. The observers are only attached to the first chain.
+     */
+    PopulationOptimizer(const Optimizer & prototype, const Crossover & crossover) :
+            numChains(std::max(1u, std::thread::hardware_concurrency())),
+            interval(5),
+            prototype(prototype),
+            crossover(crossover) {}
+
+    /**
+     * The number of parallel chains
+     */
+    int numChains;
+    /**
+     * The number of temperature levels between two recombinations
+     */
+    int interval;
+
+    /**
+     * Runs the population on a specific problem instance
+     */
+    void optimize(const TSPInstance & instance, std::vector<int> & result) const;
+
+private:
+    /**
+     * The optimizer whose configuration is used by every chain
+     */
+    const Optimizer & prototype;
+    /**
+     * The crossover operator
+     */
+    const Crossover & crossover;
+};
+
+#endif
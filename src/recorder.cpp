@@ -0,0 +1,166 @@
+#include "recorder.h"
+#include <cctype>
+#include <iomanip>
+#include <sstream>
+
+////////////////////////////////////////////////////////////////////////////////
+/// FrameRecorder
+////////////////////////////////////////////////////////////////////////////////
+
+FrameRecorder::FrameRecorder(const std::string & path, double fps, int maxQueue) :
+        path(path),
+        fps(fps),
+        maxQueue(maxQueue),
+        dropped(0),
+        failed(false),
+        stopped(false)
+{
+    thread = std::thread(&FrameRecorder::run, this);
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    close();
+}
+
+void FrameRecorder::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+    }
+    frameAvailable.notify_one();
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+/**
+ * Substitutes the frame index into the pattern of an image sequence. The
+ * pattern is never handed to printf, because it comes from the user. Returns
+ * false unless the pattern contains exactly one conversion
+ */
+static bool formatFrameName(const std::string & pattern, int index, std::string & name)
+{
+    std::ostringstream out;
+    int conversions = 0;
+    for (size_t i = 0; i < pattern.size(); i++)
+    {
+        if (pattern[i] != '%')
+        {
+            out << pattern[i];
+            continue;
+        }
+        i++;
+        if (i < pattern.size() && pattern[i] == '%')
+        {
+            out << '%';
+            continue;
+        }
+
+        // Parse "%[0][width]d"
+        const bool zeros = i < pattern.size() && pattern[i] == '0';
+        if (zeros)
+        {
+            i++;
+        }
+        int width = 0;
+        while (i < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[i])) && width < 100)
+        {
+            width = 10 * width + (pattern[i] - '0');
+            i++;
+        }
+        if (i >= pattern.size() || pattern[i] != 'd' || ++conversions > 1)
+        {
+            return false;
+        }
+        out << std::setfill(zeros ? '0' : ' ') << std::setw(width) << index;
+    }
+    name = out.str();
+    return conversions == 1;
+}
+
+bool FrameRecorder::isValidPath(const std::string & path)
+{
+    std::string name;
+    return path.find('%') == std::string::npos || formatFrameName(path, 0, name);
+}
+
+bool FrameRecorder::record(const cv::Mat & frame)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (stopped || queue.size() >= maxQueue)
+    {
+        dropped++;
+        return false;
+    }
+
+    // Reuse the memory of a written frame
+    cv::Mat copy;
+    if (!spare.empty())
+    {
+        copy = spare.back();
+        spare.pop_back();
+    }
+    lock.unlock();
+
+    frame.copyTo(copy);
+
+    lock.lock();
+    queue.push_back(copy);
+    lock.unlock();
+    frameAvailable.notify_one();
+    return true;
+}
+
+void FrameRecorder::run()
+{
+    // Patterns denote image sequences
+    const bool images = path.find('%') != std::string::npos;
+    cv::VideoWriter video;
+    std::string name;
+    int index = 0;
+
+    while (true)
+    {
+        cv::Mat frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frameAvailable.wait(lock, [this]() { return stopped || !queue.empty(); });
+            if (queue.empty())
+            {
+                // We have been stopped
+                break;
+            }
+            frame = queue.front();
+            queue.pop_front();
+        }
+
+        // Frames are discarded once writing has failed
+        if (images && !failed)
+        {
+            if (!formatFrameName(path, index, name) || !cv::imwrite(name, frame))
+            {
+                failed = true;
+            }
+        }
+        else if (!failed)
+        {
+            // The video can only be opened once the frame size is known
+            if (!video.isOpened() &&
+                    !video.open(path, CV_FOURCC('M','J','P','G'), fps, frame.size()))
+            {
+                failed = true;
+            }
+            else
+            {
+                video.write(frame);
+            }
+        }
+        index++;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        spare.push_back(frame);
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/**
+ * This class writes frames to a video or a PNG sequence on a background
+ * thread. If the path contains a pattern such as "frames/%05d.png", then every
+ * frame is written as a separate image. Otherwise, the frames are encoded as
+ * an MJPG video.
+ *
+ * Recording never blocks the caller. If the writer falls behind by more than
+ * a fixed number of frames, new frames are dropped.
+ */
+class FrameRecorder {
+public:
+    /**
+     * Constructor. Starts the writer thread
+     */
+    FrameRecorder(const std::string & path, double fps = 30, int maxQueue = 64);
+
+    /**
+     * Destructor. Writes the pending frames and closes the output
+     */
+    ~FrameRecorder();
+
+    /**
+     * Writes the pending frames and closes the output. Frames that are
+     * recorded afterwards are dropped
+     */
+    void close();
+
+    /**
+     * Copies a frame into the queue. Returns false if it has been dropped
+     */
+    bool record(const cv::Mat & frame);
+
+    /**
+     * Returns the number of dropped frames
+     */
+    int getDropped() const
+    {
+        return dropped;
+    }
+
+    /**
+     * Returns true if a frame could not be written, e.g. because the video
+     * could not be opened. All later frames are discarded
+     */
+    bool hasFailed() const
+    {
+        return failed;
+    }
+
+    /**
+     * Checks an output path. A path with a '%' must contain exactly one
+     * decimal conversion "%d" with an optional zero flag and width, e.g.
+     * "%05d". A literal '%' is written as "%%"
+     */
+    static bool isValidPath(const std::string & path);
+
+private:
+    FrameRecorder(const FrameRecorder &);
+    FrameRecorder & operator=(const FrameRecorder &);
+
+    /**
+     * The main loop of the writer thread
+     */
+    void run();
+
+    /**
+     * The output path
+     */
+    std::string path;
+    /**
+     * The frame rate of the video
+     */
+    double fps;
+    /**
+     * The maximum number of queued frames
+     */
+    size_t maxQueue;
+    /**
+     * The frames that have not been written yet
+     */
+    std::deque<cv::Mat> queue;
+    /**
+     * Written frames whose memory is reused for new ones
+     */
+    std::vector<cv::Mat> spare;
+    /**
+     * The number of dropped frames
+     */
+    int dropped;
+    /**
+     * Whether or not writing has failed
+     */
+    std::atomic<bool> failed;
+    /**
+     * Whether or not the writer shall stop
+     */
+    bool stopped;
+    /**
+     * Protects the queue
+     */
+    std::mutex mutex;
+    /**
+     * Signals new frames to the writer
+     */
+    std::condition_variable frameAvailable;
+    /**
+     * The writer thread
+     */
+    std::thread thread;
+};
+
+#endif
@@ -0,0 +1,390 @@
+#include "replica.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+/// Encoding
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The message types
+ */
+enum MessageType {
+    /**
+     * Coordinator to worker: The number of cities and their coordinates
+     */
+    MESSAGE_INSTANCE = 1,
+    /**
+     * Coordinator to worker: The energy and tour of the global best
+     */
+    MESSAGE_BEST = 2,
+    /**
+     * Worker to coordinator: The energy and tour of a local improvement
+     */
+    MESSAGE_REPORT = 3,
+    /**
+     * Worker to coordinator: The energy and tour of the final result
+     */
+    MESSAGE_DONE = 4
+};
+
+/**
+ * Appends an unsigned varint: 7 bits per byte, the high bit marks that more
+ * bytes follow
+ */
+static void appendVarint(std::string & out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+/**
+ * Reads an unsigned varint. Returns false if the data ends prematurely
+ */
+static bool readVarint(const std::string & data, size_t & offset, uint64_t & value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && offset < data.size(); shift += 7)
+    {
+        const uint8_t byte = static_cast<uint8_t>(data[offset++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Appends a float in host byte order
+ */
+static void appendFloat(std::string & out, float value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/**
+ * Reads a float. Returns false if the data ends prematurely
+ */
+static bool readFloat(const std::string & data, size_t & offset, float & value)
+{
+    if (data.size() - offset < sizeof(value))
+    {
+        return false;
+    }
+    std::memcpy(&value, data.data() + offset, sizeof(value));
+    offset += sizeof(value);
+    return true;
+}
+
+void encodeTour(const std::vector<int> & tour, std::string & out)
+{
+    appendVarint(out, tour.size());
+    int previous = 0;
+    for (size_t i = 0; i < tour.size(); i++)
+    {
+        // Zigzag encoding maps small negative differences to small numbers
+        const int64_t delta = static_cast<int64_t>(tour[i]) - previous;
+        appendVarint(out, (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+        previous = tour[i];
+    }
+}
+
+bool decodeTour(const std::string & data, size_t & offset, int n, std::vector<int> & tour)
+{
+    uint64_t size;
+    if (!readVarint(data, offset, size) || size != static_cast<uint64_t>(n))
+    {
+        return false;
+    }
+
+    tour.resize(n);
+    std::vector<char> visited(n, 0);
+    int64_t previous = 0;
+    for (int i = 0; i < n; i++)
+    {
+        uint64_t value;
+        if (!readVarint(data, offset, value))
+        {
+            return false;
+        }
+        const int64_t city = previous + (static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1));
+        if (city < 0 || city >= n || visited[city])
+        {
+            return false;
+        }
+        visited[city] = 1;
+        tour[i] = static_cast<int>(city);
+        previous = city;
+    }
+    return true;
+}
+
+/**
+ * Writes a single message
+ */
+static bool writeFrame(SocketConnection & connection, uint8_t type, const std::string & payload)
+{
+    char header[5];
+    header[0] = static_cast<char>(type);
+    for (int i = 0; i < 4; i++)
+    {
+        header[1 + i] = static_cast<char>((payload.size() >> (8 * i)) & 0xff);
+    }
+    return connection.write(header, sizeof(header)) && connection.write(payload);
+}
+
+/**
+ * Reads a single message. Returns false if the connection has been closed
+ */
+static bool readFrame(SocketConnection & connection, uint8_t & type, std::string & payload)
+{
+    char header[5];
+    if (!connection.read(header, sizeof(header)))
+    {
+        return false;
+    }
+    type = static_cast<uint8_t>(header[0]);
+    uint32_t size = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        size |= static_cast<uint32_t>(static_cast<uint8_t>(header[1 + i])) << (8 * i);
+    }
+    payload.resize(size);
+    return size == 0 || connection.read(&payload[0], size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// ReplicaCoordinator
+////////////////////////////////////////////////////////////////////////////////
+
+bool ReplicaCoordinator::run(const std::string & host, int port, std::vector<int> & result)
+{
+    const int fd = listenTcpSocket(host, port);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    bestTour.clear();
+    bestEnergy = std::numeric_limits<float>::max();
+    bestVersion = 0;
+
+    // Serve every worker on its own thread
+    std::vector<SocketConnection*> connections;
+    std::vector<std::thread> threads;
+    while (static_cast<int>(connections.size()) < numWorkers)
+    {
+        const int client = accept(fd, 0, 0);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            break;
+        }
+        connections.push_back(new SocketConnection(client));
+        threads.push_back(std::thread(&ReplicaCoordinator::serve, this, std::ref(*connections.back())));
+    }
+    close(fd);
+
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+        DELETE_PTR(connections[i]);
+    }
+
+    result = bestTour;
+    return true;
+}
+
+void ReplicaCoordinator::serve(SocketConnection & connection)
+{
+    const std::vector<City> & cities = instance.getCities();
+    const int n = static_cast<int>(cities.size());
+
+    // Send the instance
+    std::string payload;
+    appendVarint(payload, n);
+    for (int i = 0; i < n; i++)
+    {
+        appendFloat(payload, cities[i].first);
+        appendFloat(payload, cities[i].second);
+    }
+    if (!writeFrame(connection, MESSAGE_INSTANCE, payload))
+    {
+        return;
+    }
+
+    // The version of the global best this worker knows
+    uint64_t sent = 0;
+    std::vector<int> tour;
+    uint8_t type;
+    while (true)
+    {
+        // Forward a new global best
+        payload.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (sent != bestVersion)
+            {
+                appendFloat(payload, bestEnergy);
+                encodeTour(bestTour, payload);
+                sent = bestVersion;
+            }
+        }
+        if (!payload.empty() && !writeFrame(connection, MESSAGE_BEST, payload))
+        {
+            return;
+        }
+
+        if (!connection.poll(10))
+        {
+            continue;
+        }
+        if (!readFrame(connection, type, payload))
+        {
+            return;
+        }
+
+        size_t offset = 0;
+        float energy;
+        if ((type == MESSAGE_REPORT || type == MESSAGE_DONE) &&
+                readFloat(payload, offset, energy) && decodeTour(payload, offset, n, tour))
+        {
+            // Do not trust the reported energy
+            energy = instance.calcTourLength(tour);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (energy < bestEnergy)
+            {
+                bestEnergy = energy;
+                bestTour = tour;
+                bestVersion++;
+                // The worker knows its own tour
+                sent = bestVersion;
+            }
+        }
+        if (type == MESSAGE_DONE)
+        {
+            return;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// ReplicaWorker
+////////////////////////////////////////////////////////////////////////////////
+
+bool ReplicaWorker::run(const std::string & host, int port)
+{
+    // The coordinator may not be up yet
+    int fd = connectTcpSocket(host, port);
+    for (int attempt = 0; fd < 0 && attempt < 50; attempt++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        fd = connectTcpSocket(host, port);
+    }
+    if (fd < 0)
+    {
+        return false;
+    }
+    SocketConnection connection(fd);
+
+    // Receive the instance
+    uint8_t type;
+    std::string payload;
+    if (!readFrame(connection, type, payload) || type != MESSAGE_INSTANCE)
+    {
+        return false;
+    }
+    size_t offset = 0;
+    uint64_t n;
+    if (!readVarint(payload, offset, n) || n < 3 || (payload.size() - offset) != 2 * sizeof(float) * n)
+    {
+        return false;
+    }
+    std::vector<City> cities(n);
+    for (size_t i = 0; i < cities.size(); i++)
+    {
+        readFloat(payload, offset, cities[i].first);
+        readFloat(payload, offset, cities[i].second);
+    }
+    TSPInstance instance;
+    instance.swapCities(cities);
+    instance.calcDistanceMatrix();
+
+    // The communication thread needs one slot for reading and one for
+    // publishing
+    BestTourBoard board(static_cast<int>(n), 2 * numChains + 3);
+    std::atomic<bool> finished(false);
+    std::thread communication(&ReplicaWorker::communicate, this, std::ref(connection), std::ref(board), static_cast<int>(n), std::cref(finished));
+
+    CooperativeOptimizer chains(prototype);
+    chains.numChains = numChains;
+    chains.migrationPolicy = migrationPolicy;
+    std::vector<int> result;
+    chains.optimize(instance, board, result);
+
+    finished = true;
+    communication.join();
+
+    // Send the final tour
+    payload.clear();
+    appendFloat(payload, instance.calcTourLength(result));
+    encodeTour(result, payload);
+    return writeFrame(connection, MESSAGE_DONE, payload);
+}
+
+void ReplicaWorker::communicate(SocketConnection & connection, BestTourBoard & board, int n, const std::atomic<bool> & finished) const
+{
+    // The best energy the coordinator knows of
+    float known = std::numeric_limits<float>::max();
+    std::vector<int> tour;
+    std::string payload;
+    uint8_t type;
+    while (!finished)
+    {
+        // Hand the tours of other workers to the chains
+        if (connection.poll(10))
+        {
+            if (!readFrame(connection, type, payload))
+            {
+                // The coordinator has gone away. The chains continue alone
+                return;
+            }
+            size_t offset = 0;
+            float energy;
+            if (type == MESSAGE_BEST && readFloat(payload, offset, energy) && decodeTour(payload, offset, n, tour))
+            {
+                known = std::min(known, energy);
+                board.publish(tour, energy);
+            }
+        }
+
+        // Report local improvements
+        if (board.bestEnergy() < known)
+        {
+            float energy;
+            if (board.read(tour, energy) != 0 && energy < known)
+            {
+                payload.clear();
+                appendFloat(payload, energy);
+                encodeTour(tour, payload);
+                if (!writeFrame(connection, MESSAGE_REPORT, payload))
+                {
+                    return;
+                }
+                known = energy;
+            }
+        }
+    }
+}
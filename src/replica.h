@@ -0,0 +1,122 @@
+#ifndef REPLICA_H
+#define REPLICA_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "tsp.h"
+#include "parallel.h"
+#include "net.h"
+
+/**
+ * Appends a tour in compact binary form: the number of cities, the first city
+ * and the differences between consecutive cities as zigzag encoded varints.
+ */
+void encodeTour(const std::vector<int> & tour, std::string & out);
+
+/**
+ * Decodes a tour that starts at offset and advances the offset. Returns false
+ * if the data is not a permutation of n cities.
+ */
+bool decodeTour(const std::string & data, size_t & offset, int n, std::vector<int> & tour);
+
+/**
+ * The coordinator of a distributed run. Worker processes connect via TCP and
+ * receive the instance. Whenever a worker reports a better tour, the
+ * coordinator forwards it to all other workers. The run ends once every
+ * worker has sent its final tour.
+ *
+ * All messages are frames of a type byte, a 4 byte little endian length and
+ * the payload. Floats are sent in host byte order.
+ */
+class ReplicaCoordinator {
+public:
+    /**
+     * Constructor
+     */
+    ReplicaCoordinator(const TSPInstance & instance) :
+            numWorkers(1),
+            instance(instance) {}
+
+    /**
+     * The number of worker processes to wait for
+     */
+    int numWorkers;
+
+    /**
+     * Listens on a host and port and coordinates the workers. The best tour
+     * is stored in result. Returns false if the socket cannot be opened.
+     */
+    bool run(const std::string & host, int port, std::vector<int> & result);
+
+private:
+    /**
+     * Serves a single worker
+     */
+    void serve(SocketConnection & connection);
+
+    /**
+     * The instance
+     */
+    const TSPInstance & instance;
+    /**
+     * The best tour of all workers. The coordinator is not performance
+     * critical, hence, it uses a plain mutex
+     */
+    std::mutex mutex;
+    std::vector<int> bestTour;
+    float bestEnergy;
+    /**
+     * Incremented whenever the best tour changes
+     */
+    uint64_t bestVersion;
+};
+
+/**
+ * A worker process of a distributed run. It runs cooperating chains on a
+ * local board. A separate communication thread reports local improvements to
+ * the coordinator and publishes the tours of other workers to the board.
+ * Hence, the chains never wait for the network.
+ */
+class ReplicaWorker {
+public:
+    /**
+     * Constructor. Every chain copies the parameters and moves of the
+     * prototype
+     */
+    ReplicaWorker(const Optimizer & prototype) :
+            numChains(std::max(1u, std::thread::hardware_concurrency())),
+            migrationPolicy(0),
+            prototype(prototype) {}
+
+    /**
+     * The number of chains in this process
+     */
+    int numChains;
+    /**
+     * The migration policy of the chains
+     */
+    MigrationPolicy* migrationPolicy;
+
+    /**
+     * Connects to a coordinator and runs until the annealing is done. The 
+     * connection is retried for 5 seconds. Returns false if it fails
+     */
+    bool run(const std::string & host, int port);
+
+private:
+    /**
+     * The main loop of the communication thread
+     */
+    void communicate(SocketConnection & connection, BestTourBoard & board, int n, const std::atomic<bool> & finished) const;
+
+    /**
+     * The optimizer whose configuration is used by every chain
+     */
+    const Optimizer & prototype;
+};
+
+#endif
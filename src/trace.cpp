@@ -0,0 +1,260 @@
+#include "trace.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+/// TraceChannel
+////////////////////////////////////////////////////////////////////////////////
+
+TraceChannel::TraceChannel(int capacity, uint16_t index) :
+        events(capacity),
+        index(index),
+        run(0),
+        used(false),
+        dropped(0),
+        head(0),
+        tail(0)
+{
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// TraceRecorder
+////////////////////////////////////////////////////////////////////////////////
+
+const char* const TraceRecorder::fileMagic = "SATRACE1";
+
+TraceRecorder::~TraceRecorder()
+{
+    if (writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            stopped = true;
+        }
+        condition.notify_all();
+        writer.join();
+    }
+
+    if (fd >= 0)
+    {
+        // Cut off the unused part of the mapping
+        munmap(mapping, mappingSize);
+        if (ftruncate(fd, fileSize) != 0)
+        {
+            std::cerr << "Cannot truncate trace file." << std::endl;
+        }
+        close(fd);
+    }
+
+    for (size_t i = 0; i < channels.size(); i++)
+    {
+        delete channels[i];
+    }
+}
+
+bool TraceRecorder::open(const std::string & path)
+{
+    assert(fd < 0);
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (!reserve(1 << 20))
+    {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    // Write the header
+    const uint64_t eventSize = sizeof(TraceEvent);
+    std::memcpy(mapping, fileMagic, 8);
+    std::memcpy(mapping + 8, &eventSize, sizeof(eventSize));
+    fileSize = 16;
+
+    start = std::chrono::steady_clock::now();
+    writer = std::thread(&TraceRecorder::run, this);
+    return true;
+}
+
+TraceChannel* TraceRecorder::openChannel()
+{
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(channelMutex);
+    TraceChannel* channel = 0;
+    for (size_t i = 0; i < channels.size() && channel == 0; i++)
+    {
+        if (!channels[i]->used.load(std::memory_order_acquire))
+        {
+            channel = channels[i];
+        }
+    }
+    if (channel == 0)
+    {
+        if (channels.size() >= 65536)
+        {
+            return 0;
+        }
+        channel = new TraceChannel(channelCapacity, static_cast<uint16_t>(channels.size()));
+        channels.push_back(channel);
+    }
+    channel->used.store(true, std::memory_order_relaxed);
+    channel->run = runs.fetch_add(1, std::memory_order_relaxed);
+    return channel;
+}
+
+void TraceRecorder::closeChannel(TraceChannel* channel)
+{
+    if (channel != 0)
+    {
+        channel->used.store(false, std::memory_order_release);
+    }
+}
+
+uint64_t TraceRecorder::getDropped() const
+{
+    std::lock_guard<std::mutex> lock(channelMutex);
+    uint64_t dropped = 0;
+    for (size_t i = 0; i < channels.size(); i++)
+    {
+        dropped += channels[i]->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+void TraceRecorder::run()
+{
+    std::unique_lock<std::mutex> lock(writerMutex);
+    while (!stopped)
+    {
+        lock.unlock();
+        drain();
+        lock.lock();
+        condition.wait_for(lock, std::chrono::milliseconds(5));
+    }
+    lock.unlock();
+
+    // Write the events that arrived in the meantime
+    drain();
+}
+
+size_t TraceRecorder::drain()
+{
+    std::vector<TraceChannel*> current;
+    {
+        std::lock_guard<std::mutex> lock(channelMutex);
+        current = channels;
+    }
+
+    size_t total = 0;
+    for (size_t c = 0; c < current.size(); c++)
+    {
+        TraceChannel & channel = *current[c];
+        const uint64_t t = channel.tail.load(std::memory_order_relaxed);
+        const uint64_t h = channel.head.load(std::memory_order_acquire);
+        if (h == t)
+        {
+            continue;
+        }
+        const size_t count = static_cast<size_t>(h - t);
+        if (!reserve(fileSize + count * sizeof(TraceEvent)))
+        {
+            // Drop the events rather than blocking the chains
+            channel.dropped.fetch_add(count, std::memory_order_relaxed);
+            channel.tail.store(h, std::memory_order_release);
+            continue;
+        }
+
+        // The events may wrap around the end of the ring
+        const size_t capacity = channel.events.size();
+        const size_t first = static_cast<size_t>(t & (capacity - 1));
+        const size_t part = std::min(count, capacity - first);
+        std::memcpy(mapping + fileSize, &channel.events[first], part * sizeof(TraceEvent));
+        std::memcpy(mapping + fileSize + part * sizeof(TraceEvent), &channel.events[0], (count - part) * sizeof(TraceEvent));
+        fileSize += count * sizeof(TraceEvent);
+
+        channel.tail.store(h, std::memory_order_release);
+        total += count;
+    }
+    return total;
+}
+
+bool TraceRecorder::reserve(size_t size)
+{
+    if (size <= mappingSize)
+    {
+        return true;
+    }
+
+    // Grow the file geometrically
+    const size_t newSize = std::max(size, 2 * mappingSize);
+    if (mapping != 0)
+    {
+        munmap(mapping, mappingSize);
+        mapping = 0;
+        mappingSize = 0;
+    }
+    if (ftruncate(fd, newSize) != 0)
+    {
+        return false;
+    }
+    void* address = mmap(0, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        return false;
+    }
+    mapping = static_cast<char*>(address);
+    mappingSize = newSize;
+    return true;
+}
+
+bool TraceRecorder::convertToCSV(std::istream & in, std::ostream & out)
+{
+    char magic[8];
+    uint64_t eventSize;
+    if (!in.read(magic, 8) || !std::equal(magic, magic + 8, fileMagic) ||
+            !in.read(reinterpret_cast<char*>(&eventSize), sizeof(eventSize)) ||
+            eventSize != sizeof(TraceEvent))
+    {
+        return false;
+    }
+
+    out << "time_ns,run,chain,event,level,iteration,temperature,energy,best_energy,move,delta,acceptance\n";
+    const char* types[] = {"level", "rejected", "accepted"};
+    TraceEvent event;
+    while (in.read(reinterpret_cast<char*>(&event), sizeof(event)))
+    {
+        out << event.time << ','
+            << event.run << ','
+            << event.chain << ','
+            << (event.type <= TraceEvent::ACCEPTED ? types[event.type] : "unknown") << ','
+            << event.level << ','
+            << event.iteration << ','
+            << event.temperature << ','
+            << event.energy << ','
+            << event.bestEnergy << ',';
+        if (event.type == TraceEvent::LEVEL)
+        {
+            out << ",," << event.delta << '\n';
+        }
+        else
+        {
+            if (event.move != TraceEvent::noMove)
+            {
+                out << static_cast<int>(event.move);
+            }
+            out << ',' << event.delta << ",\n";
+        }
+    }
+    return true;
+}
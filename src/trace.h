@@ -0,0 +1,283 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * A single trace event. The events are written to the trace file as they are
+ * in memory.
+ */
+class TraceEvent {
+public:
+    /**
+     * The event types
+     */
+    enum Type {
+        /**
+         * The end of a temperature level
+         */
+        LEVEL = 0,
+        /**
+         * A sampled iteration whose proposal has been rejected
+         */
+        REJECTED = 1,
+        /**
+         * A sampled iteration whose proposal has been accepted
+         */
+        ACCEPTED = 2
+    };
+
+    /**
+     * The move id of batched 2-opt proposals and of level events
+     */
+    static const uint8_t noMove = 255;
+
+    /**
+     * The time since the recorder has been opened in nanoseconds
+     */
+    uint64_t time;
+    /**
+     * The run. Every call of Optimizer::optimize is a new run
+     */
+    uint32_t run;
+    /**
+     * The temperature level
+     */
+    uint32_t level;
+    /**
+     * The iteration within the level. For level events, the number of
+     * iterations of the level
+     */
+    uint32_t iteration;
+    /**
+     * The temperature
+     */
+    float temperature;
+    /**
+     * The energy of the current state
+     */
+    float energy;
+    /**
+     * The best energy so far
+     */
+    float bestEnergy;
+    /**
+     * The energy difference of the proposal. For level events, the
+     * acceptance rate of the level
+     */
+    float delta;
+    /**
+     * The channel that recorded the event
+     */
+    uint16_t chain;
+    /**
+     * The event type
+     */
+    uint8_t type;
+    /**
+     * The index of the move that created the proposal
+     */
+    uint8_t move;
+};
+
+/**
+ * A ring buffer of events with a single producer (a chain) and a single
+ * consumer (the writer thread of the recorder). Recording never blocks. If
+ * the buffer is full, the event is dropped.
+ */
+class TraceChannel {
+public:
+    /**
+     * Constructor. The capacity must be a power of two
+     */
+    TraceChannel(int capacity, uint16_t index);
+
+    /**
+     * Records an event. The run and chain are filled in
+     */
+    void record(TraceEvent & event)
+    {
+        const uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= events.size())
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        event.run = run;
+        event.chain = index;
+        events[h & (events.size() - 1)] = event;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+private:
+    friend class TraceRecorder;
+
+    /**
+     * The events
+     */
+    std::vector<TraceEvent> events;
+    /**
+     * The index of the channel
+     */
+    uint16_t index;
+    /**
+     * The current run
+     */
+    uint32_t run;
+    /**
+     * Whether or not a chain uses the channel
+     */
+    std::atomic<bool> used;
+    /**
+     * The number of dropped events
+     */
+    std::atomic<uint64_t> dropped;
+    /**
+     * The next event to write and the next event to read. They are padded
+     * onto different cache lines such that producer and consumer do not
+     * interfere
+     */
+    char paddingHead[64];
+    std::atomic<uint64_t> head;
+    char paddingTail[64];
+    std::atomic<uint64_t> tail;
+};
+
+/**
+ * This class records trace events of several chains into a memory mapped
+ * binary file. Every chain writes into its own preallocated channel and a
+ * background thread copies the events into the file. The file starts with
+ * the 8 bytes of fileMagic and the size of an event as 64 bit integer.
+ */
+class TraceRecorder {
+public:
+    /**
+     * Constructor
+     */
+    TraceRecorder() :
+            sampleInterval(64),
+            channelCapacity(1 << 14),
+            fd(-1),
+            mapping(0),
+            mappingSize(0),
+            fileSize(0),
+            runs(0),
+            stopped(false) {}
+
+    /**
+     * Destructor. Writes the remaining events and closes the file
+     */
+    ~TraceRecorder();
+
+    /**
+     * Every sampleInterval-th iteration of a chain is recorded. Set to 0 in
+     * order to only record the temperature levels
+     */
+    int sampleInterval;
+    /**
+     * The number of events per channel
+     */
+    int channelCapacity;
+
+    /**
+     * Opens the trace file and starts the writer thread. Returns false if the
+     * file cannot be created.
+     */
+    bool open(const std::string & path);
+
+    /**
+     * Returns a free channel for a new run. Returns 0 if the recorder is not
+     * open
+     */
+    TraceChannel* openChannel();
+
+    /**
+     * Hands a channel back. Its remaining events are still written
+     */
+    void closeChannel(TraceChannel* channel);
+
+    /**
+     * Returns the number of nanoseconds since the recorder has been opened
+     */
+    uint64_t now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * Returns the number of events that have been dropped because a channel
+     * was full
+     */
+    uint64_t getDropped() const;
+
+    /**
+     * Converts a trace file to CSV. Returns false if the input is not a trace
+     */
+    static bool convertToCSV(std::istream & in, std::ostream & out);
+
+    /**
+     * The first bytes of a trace file
+     */
+    static const char* const fileMagic;
+
+private:
+    TraceRecorder(const TraceRecorder &);
+    TraceRecorder & operator=(const TraceRecorder &);
+
+    /**
+     * The main loop of the writer thread
+     */
+    void run();
+
+    /**
+     * Copies the pending events of all channels into the file. Returns the
+     * number of events
+     */
+    size_t drain();
+
+    /**
+     * Makes sure that the mapping can hold size bytes
+     */
+    bool reserve(size_t size);
+
+    /**
+     * The channels. They are only deleted by the destructor
+     */
+    std::vector<TraceChannel*> channels;
+    /**
+     * Protects the list of channels
+     */
+    mutable std::mutex channelMutex;
+    /**
+     * The file, the mapping and the number of bytes that have been written
+     */
+    int fd;
+    char* mapping;
+    size_t mappingSize;
+    size_t fileSize;
+    /**
+     * The number of runs so far
+     */
+    std::atomic<uint32_t> runs;
+    /**
+     * The point in time when the recorder has been opened
+     */
+    std::chrono::steady_clock::time_point start;
+    /**
+     * The writer thread
+     */
+    std::thread writer;
+    std::mutex writerMutex;
+    std::condition_variable condition;
+    bool stopped;
+};
+
+#endif
@@ -1,4 +1,13 @@
 #include "tsp.h"
+#include "recorder.h"
+#include "batchsampler.h"
+#include "trace.h"
+#include "pool.h"
+#include <cstdint>
+
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
 /// TSPInstance
@@ -10,6 +19,7 @@ void TSPInstance::createRandom(int n)
     std::mt19937 generator({std::random_device{}()});
     std::uniform_real_distribution<float> distribution(0.0f,999.0f);
 
+    cities.reserve(cities.size() + n);
     for (int i = 0; i < n; i++)
     {
         // Create a random city
@@ -19,7 +29,7 @@ void TSPInstance::createRandom(int n)
     }
 }
 
-void TSPInstance::readTSPLIB(std::istream & sin)
+bool TSPInstance::readTSPLIB(std::istream & sin)
 {
     // Wait for the NODE_COORD_SECTION token
     const std::string startToken = "NODE_COORD_SECTION";
@@ -27,7 +37,11 @@ void TSPInstance::readTSPLIB(std::istream & sin)
 
     std::string parser;
     do {
-        sin >> parser;
+        if (!(sin >> parser))
+        {
+            // This is not a TSPLIB file
+            return false;
+        }
     } while (parser != startToken);
 
     // Parse the cities
@@ -35,9 +49,9 @@ void TSPInstance::readTSPLIB(std::istream & sin)
     {
         City city;
 
-        // The first element is the ID of the city or the EOF tag
-        sin >> parser;
-        if (parser == endToken)
+        // The first element is the ID of the city or the EOF tag. Some files
+        // end without the tag
+        if (!(sin >> parser) || parser == endToken)
         {
             // We are done
             break;
@@ -46,27 +60,216 @@ void TSPInstance::readTSPLIB(std::istream & sin)
         // Now come the two coordinates
         sin >> city.first;
         sin >> city.second;
+        if (!sin)
+        {
+            return false;
+        }
         addCity(city);
     }
+    return true;
+}
+
+const char* const TSPInstance::binaryMagic = "SATSPBIN";
+
+bool TSPInstance::readBinary(std::istream & sin)
+{
+    char magic[8];
+    if (!sin.read(magic, 8) || !std::equal(magic, magic + 8, binaryMagic))
+    {
+        return false;
+    }
+    uint64_t n;
+    if (!sin.read(reinterpret_cast<char*>(&n), sizeof(n)) || n > static_cast<uint64_t>(std::numeric_limits<int>::max()))
+    {
+        return false;
+    }
+
+    // Read the coordinates in chunks. The cities grow with every chunk that
+    // has actually been read, such that a corrupt count in the header cannot
+    // allocate more memory than the file holds
+    const size_t offset = cities.size();
+    std::vector<float> buffer;
+    for (size_t first = 0; first < n; first += 65536)
+    {
+        const size_t end = std::min(static_cast<size_t>(n), first + 65536);
+        buffer.resize(2 * (end - first));
+        if (!sin.read(reinterpret_cast<char*>(buffer.data()), buffer.size() * sizeof(float)))
+        {
+            cities.resize(offset);
+            return false;
+        }
+        for (size_t i = 0; i < end - first; i++)
+        {
+            cities.push_back(std::make_pair(buffer[2 * i], buffer[2 * i + 1]));
+        }
+    }
+    return true;
+}
+
+bool TSPInstance::read(std::istream & sin)
+{
+    const std::istream::pos_type start = sin.tellg();
+    if (readBinary(sin))
+    {
+        return true;
+    }
+    sin.clear();
+    sin.seekg(start);
+    return readTSPLIB(sin);
+}
+
+/**
+ * The edge length of the tiles of the distance matrix. A tile fits into the 
+ * L2 cache, such that it can be mirrored without going to memory
+ */
+static const int distanceTileSize = 256;
+
+/**
+ * Fills the columns j0 <= j < j1 of the upper triangle of the distance matrix
+ * tile by tile and mirrors every tile into the lower triangle. The 
+ * coordinates are given as separate arrays
+ */
+static void calcDistanceColumns(const float* x, const float* y, int j0, int j1, float* data, size_t stride)
+{
+    for (int i0 = 0; i0 < j1; i0 += distanceTileSize)
+    {
+        const int i1 = std::min(i0 + distanceTileSize, j1);
+        
+        // Compute the pairs i <= j of the tile along the columns
+        for (int j = j0; j < j1; j++)
+        {
+            float* column = data + j * stride;
+            const int end = std::min(i1, j + 1);
+            int i = i0;
+#ifdef __AVX__
+            const __m256 xj = _mm256_set1_ps(x[j]);
+            const __m256 yj = _mm256_set1_ps(y[j]);
+            for (; i + 8 <= end; i += 8)
+            {
+                const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), xj);
+                const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), yj);
+                _mm256_storeu_ps(column + i, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy))));
+            }
+#endif
+            for (; i < end; i++)
+            {
+                const float dx = x[i] - x[j];
+                const float dy = y[i] - y[j];
+                column[i] = std::sqrt(dx*dx + dy*dy);
+            }
+        }
+        
+        // The distance matrix is symmetric. The tile is written into the 
+        // columns i0 <= i < i1
+        for (int i = i0; i < i1; i++)
+        {
+            float* column = data + i * stride;
+            for (int j = std::max(j0, i + 1); j < j1; j++)
+            {
+                column[j] = data[i + j * stride];
+            }
+        }
+    }
 }
 
 void TSPInstance::calcDistanceMatrix()
 {
     // Get the number of cities
-    int n = static_cast<int>(cities.size());
+    const int n = static_cast<int>(cities.size());
 
-    // Allocate the new one
-    distances = Matrix<float>(n,n);
+    // Allocate the new one. The memory of a previous instance is reused
+    distances.resize(n,n);
+    
+    // Split the coordinates for vectorization
+    std::vector<float> x(n), y(n);
+    for (int i = 0; i < n; i++)
+    {
+        x[i] = cities[i].first;
+        y[i] = cities[i].second;
+    }
+    
+    const size_t stride = static_cast<size_t>(distances.rows());
+    for (int j0 = 0; j0 < n; j0 += distanceTileSize)
+    {
+        calcDistanceColumns(&x[0], &y[0], j0, std::min(j0 + distanceTileSize, n), distances.data(), stride);
+    }
+}
 
+void TSPInstance::calcDistanceMatrix(WorkerPool & pool)
+{
+    const int n = static_cast<int>(cities.size());
+    distances.resize(n,n);
+    
+    std::vector<float> x(n), y(n);
     for (int i = 0; i < n; i++)
     {
-        for (int j = i; j < n; j++)
+        x[i] = cities[i].first;
+        y[i] = cities[i].second;
+    }
+    
+    // Every task fills a strip of columns. The strips on the right cover 
+    // more tiles, so they are submitted first
+    const size_t stride = static_cast<size_t>(distances.rows());
+    float* data = distances.data();
+    const int numStrips = (n + distanceTileSize - 1) / distanceTileSize;
+    for (int s = numStrips - 1; s >= 0; s--)
+    {
+        pool.submit([&x, &y, s, n, data, stride](int) {
+            const int j0 = s * distanceTileSize;
+            calcDistanceColumns(&x[0], &y[0], j0, std::min(j0 + distanceTileSize, n), data, stride);
+        });
+    }
+    pool.wait();
+}
+
+int TSPInstance::insertCity(const City & city)
+{
+    const int n = static_cast<int>(cities.size());
+    assert(distances.rows() >= n);
+
+    // Grow the matrix by a quarter such that insertions are amortized O(n) 
+    // while the memory stays within about 1.6 times the matrix
+    if (distances.rows() == n)
+    {
+        const int capacity = std::max(16, n + n / 4);
+        Matrix<float> grown(capacity, capacity);
+        for (int j = 0; j < n; j++)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                grown(i,j) = distances(i,j);
+            }
+        }
+        distances.swap(grown);
+    }
+
+    addCity(city);
+    for (int i = 0; i <= n; i++)
+    {
+        distances(i,n) = dist(cities[i], city);
+        distances(n,i) = distances(i,n);
+    }
+    return n;
+}
+
+void TSPInstance::removeCity(int i)
+{
+    const int last = static_cast<int>(cities.size()) - 1;
+    assert(i >= 0 && i <= last);
+    assert(distances.rows() > last);
+
+    // Move the last city into the gap
+    if (i != last)
+    {
+        cities[i] = cities[last];
+        for (int j = 0; j < last; j++)
         {
-            // The distance matrix is symmetric
-            distances(i,j) = dist(cities[i], cities[j]);
-            distances(j,i) = dist(cities[i], cities[j]);
+            distances(i,j) = distances(last,j);
+            distances(j,i) = distances(last,j);
         }
+        distances(i,i) = 0;
     }
+    cities.pop_back();
 }
 
 float TSPInstance::calcTourLength(const std::vector<int> & tour) const
@@ -89,7 +292,36 @@ float TSPInstance::calcTourLength(const std::vector<int> & tour) const
 /// Optimizer
 ////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * Records a single trace event
+ */
+static void traceEvent(const TraceRecorder & tracer, TraceChannel & channel, const Optimizer::Config & config, uint8_t type, uint8_t move, float delta)
+{
+    TraceEvent event;
+    event.time = tracer.now();
+    event.level = config.outer;
+    event.iteration = config.inner;
+    event.temperature = config.temp;
+    event.energy = config.energy;
+    event.bestEnergy = config.bestEnergy;
+    event.delta = delta;
+    event.type = type;
+    event.move = move;
+    channel.record(event);
+}
+
 void Optimizer::optimize(const TSPInstance& instance, std::vector<int> & result) const
+{
+    anneal(instance, 0, result);
+}
+
+void Optimizer::optimize(const TSPInstance& instance, const std::vector<int> & initial, std::vector<int> & result) const
+{
+    assert(initial.size() == instance.getCities().size());
+    anneal(instance, &initial, result);
+}
+
+void Optimizer::anneal(const TSPInstance& instance, const std::vector<int>* initial, std::vector<int> & result) const
 {
     // Get the number of cities
     int n = static_cast<int>(instance.getCities().size());
@@ -101,32 +333,41 @@ void Optimizer::optimize(const TSPInstance& instance, std::vector<int> & result)
     // Set up the runtime configuration
     Config config;
     
+    std::mt19937 g(seed != 0 ? seed : std::random_device{}());
+    
     // Set up some initial tour
-    config.state.resize(n);
     config.bestState.resize(n);
-    for (int i = 0; i < n; i++)
+    if (initial != 0)
     {
-        config.state[i] = i;
+        config.state = *initial;
+    }
+    else
+    {
+        config.state.resize(n);
+        for (int i = 0; i < n; i++)
+        {
+            config.state[i] = i;
+        }
+        
+        // Shuffle the array randomly. We use our own generator instead of 
+        // std::rand such that several chains can run in parallel
+        std::shuffle(config.state.begin() + 1, config.state.end(), g);
     }
-
-    // Shuffle the array randomly
-    std::srand ( unsigned ( std::time(0) ) );
-    std::random_shuffle(config.state.begin() + 1, config.state.end());
     
     config.energy = instance.calcTourLength(config.state);
     
     config.bestEnergy = config.energy;
+    config.bestState = config.state;
     
     config.temp = coolingSchedule->initialTemp();
     
-    std::mt19937 g({std::random_device{}()});
     // Set up an initial distribution over the possible moves
     std::uniform_int_distribution<int> moveDist(0,static_cast<int>(moves.size()) - 1);
     // A uniform distribution for the acceptance probability
     std::uniform_real_distribution<float> uniformDist(0.0f,1.0f);
     
     // Set up the mover service 
-    Optimizer::MoveService* service = new Optimizer::MoveService(n);
+    Optimizer::MoveService* service = new Optimizer::MoveService(n, g());
     for (size_t i = 0; i < moves.size(); i++)
     {
         moves[i]->setMoveService(service);
@@ -135,81 +376,218 @@ void Optimizer::optimize(const TSPInstance& instance, std::vector<int> & result)
     // The current proposal/neighbor
     std::vector<int> proposal;
     
+    // Batched proposals for cold temperature levels
+    BatchSampler* sampler = 0;
+    if (batchSize > 0 && n >= 3)
+    {
+        sampler = new BatchSampler(instance, batchSize, g());
+    }
+    // The acceptance rate of the last level
+    float acceptance = 1;
+    
     // A total loop counter for the notification cycle
     int loopCounter = 0;
     
+    // Record the trajectory. Only every few iterations are sampled
+    TraceChannel* channel = tracer != 0 ? tracer->openChannel() : 0;
+    const int traceInterval = channel != 0 ? tracer->sampleInterval : 0;
+    int traceCountdown = traceInterval;
+    
+    // The point in time when the time budget is exhausted
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + 
+            std::chrono::microseconds(static_cast<long long>(timeLimit * 1e6));
+    bool timeout = false;
+    
     // Start the optimization
-    for (config.outer = 0; config.outer < outerLoops; config.outer++)
+    for (config.outer = 0; config.outer < outerLoops && !timeout; config.outer++)
     {
         // Determine the next temperature
         config.temp = coolingSchedule->nextTemp(config);
         
-        // Simulate the markov chain
-        for (config.inner = 0; config.inner < innerLoops; config.inner++)
+        // The number of accepted proposals in this level
+        int accepted = 0;
+        
+        // Almost all proposals are rejected at this temperature. Evaluate
+        // them in batches
+        if (sampler != 0 && acceptance < batchAcceptance)
         {
-            proposal = config.state;
-            
-            // Propose a new neighbor according to some move
-            // Choose the move
-            int m = moveDist(g);
-            moves[m]->propose(proposal);
-            
-            // Get the energy of the new proposal
-            const float energy = instance.calcTourLength(proposal);
-            const float delta = energy - config.energy;
-            
-            // Did we decrease the energy?
-            if (delta <= 0)
+            config.inner = 0;
+            while (config.inner < innerLoops && !timeout)
             {
-                // Accept the move
-                config.state = proposal;
-                config.energy = energy;
+                const float energy = config.energy;
+                bool stepAccepted;
+                const int steps = sampler->step(config.state, config.energy, config.temp, innerLoops - config.inner, stepAccepted);
+                if (stepAccepted)
+                {
+                    accepted++;
+                }
+                
+                // Is this better than the best global optimum?
+                if (config.energy < config.bestEnergy)
+                {
+                    config.bestEnergy = config.energy;
+                    config.bestState = config.state;
+                }
+                
+                // Did we pass a notification?
+                const int nextNotification = (loopCounter + notificationCycle - 1) / notificationCycle * notificationCycle;
+                if (nextNotification < loopCounter + steps)
+                {
+                    notifyObservers(instance, config);
+                }
+                loopCounter += steps;
+                config.inner += steps;
+                
+                // Did we pass a trace sample?
+                if (traceInterval > 0 && (traceCountdown -= steps) <= 0)
+                {
+                    traceCountdown = traceInterval - (-traceCountdown) % traceInterval;
+                    traceEvent(*tracer, *channel, config, 
+                            stepAccepted ? TraceEvent::ACCEPTED : TraceEvent::REJECTED, 
+                            TraceEvent::noMove, config.energy - energy);
+                }
+                
+                timeout = timeLimit > 0 && std::chrono::steady_clock::now() > deadline;
             }
-            else
+            
+            // Get rid of accumulated rounding errors
+            config.energy = instance.calcTourLength(config.state);
+        }
+        else
+        {
+            // Simulate the markov chain
+            for (config.inner = 0; config.inner < innerLoops; config.inner++)
             {
-                // Accept the proposal with a certain probability
-                float u = uniformDist(g);
-                if (u <= std::exp(-1/config.temp * delta))
+                proposal = config.state;
+                
+                // Propose a new neighbor according to some move
+                // Choose the move
+                int m = moveDist(g);
+                moves[m]->propose(proposal);
+                
+                // Get the energy of the new proposal
+                const float energy = instance.calcTourLength(proposal);
+                const float delta = energy - config.energy;
+                
+                // Did we decrease the energy?
+                bool accept = false;
+                if (delta <= 0)
                 {
+                    // Accept the move
                     config.state = proposal;
                     config.energy = energy;
+                    accept = true;
+                    // Degenerate moves that do not change anything do not
+                    // count as accepted
+                    if (delta < 0)
+                    {
+                        accepted++;
+                    }
+                }
+                else
+                {
+                    // Accept the proposal with a certain probability
+                    float u = uniformDist(g);
+                    if (u <= std::exp(-1/config.temp * delta))
+                    {
+                        config.state = proposal;
+                        config.energy = energy;
+                        accept = true;
+                        accepted++;
+                    }
+                }
+                
+                // Is this better than the best global optimum?
+                if (energy < config.bestEnergy)
+                {
+                    // It is
+                    config.bestEnergy = energy;
+                    config.bestState = proposal;
+                }
+                
+                // Should we record this iteration?
+                if (traceInterval > 0 && --traceCountdown == 0)
+                {
+                    traceCountdown = traceInterval;
+                    traceEvent(*tracer, *channel, config, 
+                            accept ? TraceEvent::ACCEPTED : TraceEvent::REJECTED, 
+                            static_cast<uint8_t>(m), delta);
+                }
+                
+                // Should we notify the observers?
+                if ((loopCounter % notificationCycle) == 0)
+                {
+                    // Yes, we should
+                    notifyObservers(instance, config);
+                }
+                loopCounter++;
+                
+                // Check the time budget every now and then
+                if (timeLimit > 0 && (loopCounter % 256) == 0 && std::chrono::steady_clock::now() > deadline)
+                {
+                    timeout = true;
+                    break;
                 }
             }
             
-            // Is this better than the best global optimum?
-            if (energy < config.bestEnergy)
-            {
-                // It is
-                config.bestEnergy = energy;
-                config.bestState = proposal;
-            }
-            
-            // Should we notify the observers?
-            if ((loopCounter % notificationCycle) == 0)
+            // Keep track of the acceptance rate
+            acceptance = static_cast<float>(accepted) / std::max(1, config.inner);
+        }
+        
+        // Descend to the next local optimum
+        if (localSearch != 0 && localSearchEachLevel)
+        {
+            config.energy = localSearch->improve(instance, config.state);
+            if (config.energy < config.bestEnergy)
             {
-                // Yes, we should
-                for (size_t i = 0; i < observers.size(); i++)
-                {
-                    observers[i]->notify(instance, config);
-                }
+                config.bestEnergy = config.energy;
+                config.bestState = config.state;
             }
-            loopCounter++;
+        }
+        
+        // Run the level hooks
+        for (size_t i = 0; i < hooks.size(); i++)
+        {
+            hooks[i]->levelFinished(instance, config);
+        }
+        
+        if (channel != 0)
+        {
+            traceEvent(*tracer, *channel, config, TraceEvent::LEVEL, TraceEvent::noMove, 
+                    static_cast<float>(accepted) / std::max(1, config.inner));
         }
     }
     
+    if (tracer != 0)
+    {
+        tracer->closeChannel(channel);
+    }
+    
     // Unregister the move service
     DELETE_PTR(service);
+    DELETE_PTR(sampler);
     for (size_t i = 0; i < moves.size(); i++)
     {
         moves[i]->setMoveService(0);
     }
     
+    // Polish the best tour
+    if (localSearch != 0)
+    {
+        config.bestEnergy = localSearch->improve(instance, config.bestState);
+    }
+    
     result = config.bestState;
     
     // Do the final notification
     config.terminated = true;
     config.state = config.bestState;
     config.energy = config.bestEnergy;
+    notifyObservers(instance, config);
+}
+
+void Optimizer::notifyObservers(const TSPInstance & instance, const Config & config) const
+{
     for (size_t i = 0; i < observers.size(); i++)
     {
         observers[i]->notify(instance, config);
@@ -222,12 +600,41 @@ void Optimizer::optimize(const TSPInstance& instance, std::vector<int> & result)
 
 void RuntimeGUI::notify(const TSPInstance & instance, const Optimizer::Config & config)
 {
+    // Nobody would see the frame
+    if (headless && recorder == 0)
+    {
+        return;
+    }
+    
+    // Limit the frame rate. The final state is always painted
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (!config.terminated && frameRate > 0 && 
+            now - lastFrame < std::chrono::microseconds(static_cast<long long>(1e6 / frameRate)))
+    {
+        return;
+    }
+    
+    // Do not paint the same picture twice
+    if (!config.terminated && config.state == lastState && config.bestState == lastBestState)
+    {
+        return;
+    }
+    lastFrame = now;
+    lastState = config.state;
+    lastBestState = config.bestState;
+    
     // The screen is split as follows:
     // 75% points
     // 25% status
 
+    // The projection only changes with the instance
+    if (projectedInstance != &instance || projected.size() != instance.getCities().size())
+    {
+        project(instance);
+    }
+
     // Clear the gui
-    gui = cv::Scalar(0);
+    background.copyTo(gui);
 
     // Get the status marker
     int statusCol = 0.75 * gui.cols;
@@ -274,75 +681,85 @@ void RuntimeGUI::notify(const TSPInstance & instance, const Optimizer::Config &
                     0.9, 
                     cv::Scalar(255,255,255));
 
-    // Plot the charts
-    // [...]
+    // Paint the best path
+    paintTour(config.bestState, cv::Scalar(0,255,255), 1);
+    // Paint the current path
+    paintTour(config.state, cv::Scalar(255,0,255), 2);
+
+    if (recorder != 0)
+    {
+        recorder->record(gui);
+    }
+
+    if (headless)
+    {
+        return;
+    }
+    cv::imshow("GUI", gui);
+    if (config.terminated)
+    {
+        cv::waitKey(0);
+    }
+    else
+    {
+        cv::waitKey(waitTime);
+    }
+}
+
+void RuntimeGUI::project(const TSPInstance & instance)
+{
+    const std::vector<City> & cities = instance.getCities();
+
+    // Get the status marker
+    int statusCol = 0.75 * gui.cols;
 
-    // Plot the cities
     // Determine the minimum and maximum X/Y
     float minX = std::numeric_limits<float>::max();
     float minY = std::numeric_limits<float>::max();
-    float maxX = std::numeric_limits<float>::min();
-    float maxY = std::numeric_limits<float>::min();
+    float maxX = std::numeric_limits<float>::lowest();
+    float maxY = std::numeric_limits<float>::lowest();
 
-    for (size_t i = 0; i < instance.getCities().size(); i++)
+    for (size_t i = 0; i < cities.size(); i++)
     {
-        minX = std::min(minX, instance.getCities()[i].second);
-        minY = std::min(minY, instance.getCities()[i].first);
-        maxX = std::max(maxX, instance.getCities()[i].second);
-        maxY = std::max(maxY, instance.getCities()[i].first);
+        minX = std::min(minX, cities[i].second);
+        minY = std::min(minY, cities[i].first);
+        maxX = std::max(maxX, cities[i].second);
+        maxY = std::max(maxY, cities[i].first);
     }
 
     // Calculate the compression factor
-    float width = maxX - minX;
-    float height = maxY - minY;
+    float width = std::max(maxX - minX, 1e-6f);
+    float height = std::max(maxY - minY, 1e-6f);
     float compression = (statusCol - 10)/width;
     if (height*compression > gui.rows-10)
     {
         compression = (gui.rows-10)/height;
     }
 
-    // Paint the best path
-    for (size_t i = 0; i < config.state.size(); i++)
-    {
-        cv::Point p1;
-        p1.x = (instance.getCities()[config.bestState[i%config.state.size()]].second - minX)* compression+5;
-        p1.y = (instance.getCities()[config.bestState[i%config.state.size()]].first - minY)* compression+5;
-        cv::Point p2;
-        p2.x = (instance.getCities()[config.bestState[(i+1)%config.state.size()]].second - minX)* compression+5;
-        p2.y = (instance.getCities()[config.bestState[(i+1)%config.state.size()]].first - minY)* compression+5;
-
-        cv::line(gui, p1, p2, cv::Scalar(0,255,255), 1, CV_AA);
-    }
-    // Paint the current path
-    for (size_t i = 0; i < config.state.size(); i++)
+    projected.resize(cities.size());
+    for (size_t i = 0; i < cities.size(); i++)
     {
-        cv::Point p1;
-        p1.x = (instance.getCities()[config.state[i%config.state.size()]].second - minX)* compression+5;
-        p1.y = (instance.getCities()[config.state[i%config.state.size()]].first - minY)* compression+5;
-        cv::Point p2;
-        p2.x = (instance.getCities()[config.state[(i+1)%config.state.size()]].second - minX)* compression+5;
-        p2.y = (instance.getCities()[config.state[(i+1)%config.state.size()]].first - minY)* compression+5;
-
-        cv::line(gui, p1, p2, cv::Scalar(255,0,255), 2, CV_AA);
+        projected[i].x = (cities[i].second - minX)* compression+5;
+        projected[i].y = (cities[i].first - minY)* compression+5;
     }
+    projectedInstance = &instance;
 
-    // Paint the cities
-    for (size_t i = 0; i < instance.getCities().size(); i++)
+    // Paint the cities once
+    background.create(gui.rows, gui.cols, CV_8UC3);
+    background = cv::Scalar(0);
+    for (size_t i = 0; i < projected.size(); i++)
     {
-        cv::Point p1;
-        p1.x = (instance.getCities()[i].second - minX)* compression+5;
-        p1.y = (instance.getCities()[i].first - minY)* compression+5;
-
-        cv::circle(gui, p1, 2, cv::Scalar(200,200,200), 2);
+        cv::circle(background, projected[i], 2, cv::Scalar(200,200,200), 2);
     }
+}
 
-    cv::imshow("GUI", gui);
-    if (config.terminated)
-    {
-        cv::waitKey(0);
-    }
-    else
+void RuntimeGUI::paintTour(const std::vector<int> & tour, const cv::Scalar & color, int thickness)
+{
+    polyline.resize(1);
+    polyline[0].resize(tour.size());
+    for (size_t i = 0; i < tour.size(); i++)
     {
-        cv::waitKey(waitTime);
+        polyline[0][i] = projected[tour[i]];
     }
-}
\ No newline at end of file
+    cv::polylines(gui, polyline, true, color, thickness, CV_AA);
+}
@@ -8,6 +8,7 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <chrono>
 #include <opencv2/opencv.hpp>
 
 #include "util.h"
@@ -15,6 +16,8 @@
 #define DELETE_PTR(p) if((p) != 0) { delete (p); (p) = 0; }
 #define DELETE_PTRA(p) if((p) != 0) { delete[] (p); (p) = 0; }
 
+class WorkerPool;
+
 /**
  * A city is just a point in the 2D plane
  */
@@ -35,21 +38,78 @@ public:
         cities.push_back(city);
     }
     
+    /**
+     * Removes all cities. The allocated memory is kept such that the instance
+     * can be reused for another problem
+     */
+    void clear()
+    {
+        cities.clear();
+    }
+    
     /**
      * Creates a random TSP instance of n nodes
      */
     void createRandom(int n);
     
     /**
-     * Reads a TSPLIB instance from a stream
+     * Reads a TSPLIB instance from a stream. Returns false if the stream does
+     * not contain a node coordinate section
+     */
+    bool readTSPLIB(std::istream & sin);
+    
+    /**
+     * Reads an instance in binary format. The format consists of the 8 bytes
+     * of binaryMagic, the number of cities as 64 bit integer and the x and y
+     * coordinates of every city as 32 bit floats, all in host byte order. 
+     * Returns false if the stream does not contain a binary instance
+     */
+    bool readBinary(std::istream & sin);
+    
+    /**
+     * Reads a binary or a TSPLIB instance. The stream must be seekable
+     */
+    bool read(std::istream & sin);
+    
+    /**
+     * Exchanges the cities with the given ones. This way, large generated 
+     * instances do not have to be copied
+     */
+    void swapCities(std::vector<City> & other)
+    {
+        cities.swap(other);
+    }
+    
+    /**
+     * The first bytes of a binary instance
      */
-    void readTSPLIB(std::istream & sin);
+    static const char* const binaryMagic;
     
     /**
-     * Sets up the distance matrix
+     * Sets up the distance matrix. The matrix is filled in tiles from a copy 
+     * of the coordinates, and every pair is computed only once
      */
     void calcDistanceMatrix();
     
+    /**
+     * Sets up the distance matrix with the workers of a pool. Must not be 
+     * called from a task of the same pool
+     */
+    void calcDistanceMatrix(WorkerPool & pool);
+    
+    /**
+     * Adds a city to an instance whose distance matrix is set up and updates 
+     * the matrix in O(n). Returns the index of the new city. 
+     */
+    int insertCity(const City & city);
+    
+    /**
+     * Removes a city from an instance whose distance matrix is set up and 
+     * updates the matrix in O(n). The last city takes over the index of the 
+     * removed one. 
+     */
+    void removeCity(int i);
+    
     /**
      * Calculates the length of a tour
      */
@@ -63,6 +123,17 @@ public:
         return distances(i,j);
     }
     
+    /**
+     * Overrides the distance between the cities i and j of an instance whose
+     * distance matrix is set up. A large negative distance forces the edge 
+     * into every good tour
+     */
+    void setDistance(int i, int j, float d)
+    {
+        distances(i,j) = d;
+        distances(j,i) = d;
+    }
+    
     /**
      * Returns the distance between two cities
      */
@@ -73,6 +144,23 @@ public:
         return std::sqrt((temp1*temp1+temp2*temp2));
     }
     
+    /**
+     * Returns the raw distance matrix. The distance between the cities i and 
+     * j is stored at index i + j * getDistanceStride()
+     */
+    const float* getDistanceData() const
+    {
+        return distances.data();
+    }
+    
+    /**
+     * Returns the stride of the raw distance matrix
+     */
+    int getDistanceStride() const
+    {
+        return distances.rows();
+    }
+    
     /**
      * Returns the cities
      */
@@ -92,6 +180,8 @@ private:
     Matrix<float> distances;
 };
 
+class TraceRecorder;
+
 /**
  * This is the optimizer. It implements the basic simulated annealing algorithm
  * and several neighborhood moves. 
@@ -173,8 +263,8 @@ public:
         /**
          * Constructor
          */
-        MoveService(int numCities) : 
-            generator({std::random_device{}()}), 
+        MoveService(int numCities, unsigned int seed) : 
+            generator(seed), 
             distribution(1, numCities-1) {}
             
         /**
@@ -200,11 +290,22 @@ public:
      */
     class Move {
     public:
+        /**
+         * Destructor
+         */
+        virtual ~Move() {}
+        
         /**
          * Computes a random neighbor according to some move strategy
          */
         virtual void propose(std::vector<int> & state) const = 0;
         
+        /**
+         * Creates a copy of this move. The copy is not bound to a move service.
+         * This is used in order to run several chains in parallel. 
+         */
+        virtual Move* clone() const = 0;
+        
         /**
          * Sets the move service
          */
@@ -220,6 +321,31 @@ public:
         MoveService* service;
     };
     
+    /**
+     * A level hook is called at the end of every temperature level. Unlike 
+     * the observers, a hook may modify the runtime configuration. If it 
+     * replaces the current state, then it has to update the energy as well. 
+     */
+    class LevelHook {
+    public:
+        /**
+         * This method is called by the optimizer
+         */
+        virtual void levelFinished(const TSPInstance & instance, Config & config) = 0;
+    };
+    
+    /**
+     * A local search deterministically improves a tour until it reaches a 
+     * local optimum. 
+     */
+    class LocalSearch {
+    public:
+        /**
+         * Improves the tour in place and returns its new length
+         */
+        virtual float improve(const TSPInstance & instance, std::vector<int> & tour) const = 0;
+    };
+    
     /**
      * Constructor
      */
@@ -227,7 +353,14 @@ public:
             coolingSchedule(0),
             outerLoops(100), 
             innerLoops(1000), 
-            notificationCycle(250) {}
+            notificationCycle(250),
+            localSearch(0),
+            localSearchEachLevel(false),
+            timeLimit(0),
+            batchSize(0),
+            batchAcceptance(0.02f),
+            tracer(0),
+            seed(0) {}
     
     /**
      * The cooling schedule
@@ -245,12 +378,54 @@ public:
      * The notification cycle. Every c iterations, the observers are notified
      */
     int notificationCycle;
+    /**
+     * The local search that polishes the best tour at the end. Set to 0 in 
+     * order to return the annealing result as is
+     */
+    LocalSearch* localSearch;
+    /**
+     * Whether or not the local search also runs on the current state at the
+     * end of every temperature level
+     */
+    bool localSearchEachLevel;
+    /**
+     * The time budget in seconds. The annealing stops early once it is 
+     * exceeded. Set to 0 for no limit
+     */
+    float timeLimit;
+    /**
+     * The number of 2-opt proposals that are evaluated at once in batched 
+     * temperature levels. Set to 0 in order to disable batched levels
+     */
+    int batchSize;
+    /**
+     * Once the acceptance rate of a level drops below this value, all 
+     * following levels are batched
+     */
+    float batchAcceptance;
+    /**
+     * The trace recorder. Every run records the end of every temperature 
+     * level and a sample of its iterations. Set to 0 in order to disable 
+     * tracing
+     */
+    TraceRecorder* tracer;
+    /**
+     * The seed of the random number generators. Runs with the same seed and
+     * parameters are identical. Set to 0 for a random seed
+     */
+    unsigned int seed;
     
     /**
      * Runs the optimizer on a specific problem instance
      */
     void optimize(const TSPInstance & instance, std::vector<int> & result) const;
     
+    /**
+     * Runs the optimizer starting from the given tour instead of a random 
+     * one. The first city of the tour stays in place
+     */
+    void optimize(const TSPInstance & instance, const std::vector<int> & initial, std::vector<int> & result) const;
+    
     /**
      * Adds an observer
      */
@@ -259,6 +434,14 @@ public:
         observers.push_back(observer);
     }
     
+    /**
+     * Adds a level hook
+     */
+    void addLevelHook(LevelHook* hook)
+    {
+        hooks.push_back(hook);
+    }
+    
     /**
      * Adds a move
      */
@@ -267,11 +450,42 @@ public:
         moves.push_back(move);
     }
     
+    /**
+     * Returns the registered observers
+     */
+    const std::vector<Observer*> & getObservers() const
+    {
+        return observers;
+    }
+    
+    /**
+     * Returns the registered moves
+     */
+    const std::vector<Move*> & getMoves() const
+    {
+        return moves;
+    }
+    
 private:
+    /**
+     * Runs the optimizer from the initial tour. If it is 0, then the 
+     * optimizer starts from a random tour
+     */
+    void anneal(const TSPInstance & instance, const std::vector<int>* initial, std::vector<int> & result) const;
+    
+    /**
+     * Notifies all observers
+     */
+    void notifyObservers(const TSPInstance & instance, const Config & config) const;
+    
     /**
      * A list of observers
      */
     std::vector<Observer*> observers;
+    /**
+     * A list of level hooks
+     */
+    std::vector<LevelHook*> hooks;
     /**
      * A list of move classes
      */
@@ -335,6 +549,14 @@ public:
         // Sample two random cities and reverse the chain
         std::reverse(state.begin() + service->sample() , state.begin() + service->sample());
     }
+    
+    /**
+     * Creates a copy of this move
+     */
+    virtual Optimizer::Move* clone() const
+    {
+        return new ChainReverseMove();
+    }
 };
 
 /**
@@ -349,6 +571,14 @@ public:
     {
         std::swap(state[service->sample()], state[service->sample()]);
     }
+    
+    /**
+     * Creates a copy of this move
+     */
+    virtual Optimizer::Move* clone() const
+    {
+        return new SwapCityMove();
+    }
 };
 
 /**
@@ -368,8 +598,18 @@ public:
                     state.begin() + c[1],
                     state.begin() + c[2]);
     }
+    
+    /**
+     * Creates a copy of this move
+     */
+    virtual Optimizer::Move* clone() const
+    {
+        return new RotateCityMove();
+    }
 };
 
+class FrameRecorder;
+
 /**
  * This is the runtime GUI that let's you watch what happens during the 
  * optimization procedure
@@ -377,12 +617,22 @@ public:
 class RuntimeGUI : public Optimizer::Observer {
 public:
     /**
-     * Constructor
+     * Constructor. A headless GUI does not open a window. Its frames can 
+     * still be recorded
      */
-    RuntimeGUI(int rows, int cols) : waitTime(25), gui(rows, cols, CV_8UC3)
+    RuntimeGUI(int rows, int cols, bool headless = false) : 
+            waitTime(25), 
+            frameRate(30),
+            recorder(0),
+            headless(headless),
+            gui(rows, cols, CV_8UC3),
+            projectedInstance(0)
     {
         // Open the window
-        cv::namedWindow("GUI", 1);
+        if (!headless)
+        {
+            cv::namedWindow("GUI", 1);
+        }
     }
     
     /**
@@ -390,7 +640,10 @@ public:
      */
     virtual ~RuntimeGUI()
     {
-        cv::destroyWindow("GUI");
+        if (!headless)
+        {
+            cv::destroyWindow("GUI");
+        }
     }
     
     /**
@@ -403,11 +656,59 @@ public:
      * it wait for a keypress
      */
     int waitTime;
+    /**
+     * The maximum number of frames per second. Notifications that arrive 
+     * earlier are skipped. Set to 0 to paint every notification
+     */
+    float frameRate;
+    /**
+     * If set, every painted frame is handed to the recorder
+     */
+    FrameRecorder* recorder;
     
 private:
+    /**
+     * Projects the cities onto the screen and paints them onto the 
+     * background
+     */
+    void project(const TSPInstance & instance);
+    
+    /**
+     * Paints a tour as a single closed polyline
+     */
+    void paintTour(const std::vector<int> & tour, const cv::Scalar & color, int thickness);
+    
+    /**
+     * Whether or not there is a window
+     */
+    bool headless;
     /**
      * The GUI matrix
      */
     cv::Mat gui;
+    /**
+     * The cities without any tour
+     */
+    cv::Mat background;
+    /**
+     * The screen positions of the cities
+     */
+    std::vector<cv::Point> projected;
+    /**
+     * The instance the projection belongs to
+     */
+    const TSPInstance* projectedInstance;
+    /**
+     * Buffer for the points of a tour
+     */
+    std::vector<std::vector<cv::Point> > polyline;
+    /**
+     * The states of the last painted frame
+     */
+    std::vector<int> lastState, lastBestState;
+    /**
+     * The time of the last painted frame
+     */
+    std::chrono::steady_clock::time_point lastFrame;
 };
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,374 @@
+#include "tuner.h"
+#include <ctime>
+#include <sstream>
+
+////////////////////////////////////////////////////////////////////////////////
+/// AnnealingParameters
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Parses a number. Returns false unless the whole string is a number
+ */
+template <class T>
+static bool parseNumber(const std::string & text, T & value)
+{
+    std::istringstream stream(text);
+    stream >> value;
+    return stream && stream.peek() == std::char_traits<char>::eof();
+}
+
+bool AnnealingParameters::set(const std::string & name, const std::string & value)
+{
+    if (name == "initialTemp")
+    {
+        return parseNumber(value, initialTemp) && initialTemp > 0;
+    }
+    if (name == "endTemp")
+    {
+        return parseNumber(value, endTemp) && endTemp > 0;
+    }
+    if (name == "alpha")
+    {
+        return parseNumber(value, alpha) && alpha > 0 && alpha < 1;
+    }
+    if (name == "outerLoops")
+    {
+        return parseNumber(value, outerLoops) && outerLoops > 0;
+    }
+    if (name == "innerLoops")
+    {
+        return parseNumber(value, innerLoops) && innerLoops > 0;
+    }
+    if (name == "batchSize")
+    {
+        return parseNumber(value, batchSize) && batchSize >= 0;
+    }
+    if (name == "moves")
+    {
+        int result = 0;
+        std::istringstream stream(value);
+        std::string move;
+        while (std::getline(stream, move, ','))
+        {
+            if (move == "reverse")
+            {
+                result |= MOVE_REVERSE;
+            }
+            else if (move == "swap")
+            {
+                result |= MOVE_SWAP;
+            }
+            else if (move == "rotate")
+            {
+                result |= MOVE_ROTATE;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        if (result == 0)
+        {
+            return false;
+        }
+        moves = result;
+        return true;
+    }
+    return false;
+}
+
+void AnnealingParameters::write(std::ostream & out) const
+{
+    out << "initialTemp " << initialTemp << "\n"
+        << "endTemp " << endTemp << "\n"
+        << "alpha " << alpha << "\n"
+        << "outerLoops " << outerLoops << "\n"
+        << "innerLoops " << innerLoops << "\n"
+        << "moves ";
+    const char* moveNames[] = {"reverse", "swap", "rotate"};
+    bool first = true;
+    for (int m = 0; m < 3; m++)
+    {
+        if (moves & (1 << m))
+        {
+            out << (first ? "" : ",") << moveNames[m];
+            first = false;
+        }
+    }
+    out << "\n"
+        << "batchSize " << batchSize << "\n";
+}
+
+std::string AnnealingParameters::toString() const
+{
+    std::stringstream stream;
+    write(stream);
+    std::string result = stream.str();
+    result.erase(result.size() - 1);
+    std::replace(result.begin(), result.end(), '\n', ';');
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// ParameterizedOptimizer
+////////////////////////////////////////////////////////////////////////////////
+
+ParameterizedOptimizer::ParameterizedOptimizer(const AnnealingParameters & parameters) :
+        schedule(parameters.initialTemp, parameters.endTemp, parameters.alpha)
+{
+    if (parameters.moves & AnnealingParameters::MOVE_REVERSE)
+    {
+        addMove(&reverseMove);
+    }
+    if (parameters.moves & AnnealingParameters::MOVE_SWAP)
+    {
+        addMove(&swapMove);
+    }
+    if (parameters.moves & AnnealingParameters::MOVE_ROTATE)
+    {
+        addMove(&rotateMove);
+    }
+    coolingSchedule = &schedule;
+    outerLoops = parameters.outerLoops;
+    innerLoops = parameters.innerLoops;
+    batchSize = parameters.batchSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// ParameterSpace
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Splits a range "low:high". Returns false if the value is not a range
+ */
+static bool splitRange(const std::string & value, std::string & low, std::string & high)
+{
+    const size_t colon = value.find(':');
+    if (colon == std::string::npos)
+    {
+        return false;
+    }
+    low = value.substr(0, colon);
+    high = value.substr(colon + 1);
+    return true;
+}
+
+bool ParameterSpace::read(std::istream & in, std::string & error)
+{
+    values.clear();
+    std::string line;
+    for (int number = 1; std::getline(in, line); number++)
+    {
+        std::istringstream stream(line);
+        std::string name;
+        if (!(stream >> name) || name[0] == '#')
+        {
+            continue;
+        }
+
+        std::vector<std::string> & list = values[name];
+        std::string value;
+        while (stream >> value)
+        {
+            // Validate the value
+            AnnealingParameters parameters;
+            std::string low, high;
+            const bool valid = splitRange(value, low, high) ?
+                    name != "moves" && parameters.set(name, low) && parameters.set(name, high) :
+                    parameters.set(name, value);
+            if (!valid)
+            {
+                std::stringstream message;
+                message << "Invalid value " << value << " for " << name << " in line " << number << ".";
+                error = message.str();
+                return false;
+            }
+            list.push_back(value);
+        }
+        if (list.empty())
+        {
+            std::stringstream message;
+            message << "No values for " << name << " in line " << number << ".";
+            error = message.str();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ParameterSpace::grid(std::vector<AnnealingParameters> & configurations) const
+{
+    configurations.assign(1, AnnealingParameters());
+    for (std::map<std::string, std::vector<std::string> >::const_iterator it = values.begin(); it != values.end(); ++it)
+    {
+        std::vector<AnnealingParameters> next;
+        for (size_t v = 0; v < it->second.size(); v++)
+        {
+            std::string low, high;
+            if (splitRange(it->second[v], low, high))
+            {
+                return false;
+            }
+            for (size_t c = 0; c < configurations.size(); c++)
+            {
+                next.push_back(configurations[c]);
+                next.back().set(it->first, it->second[v]);
+            }
+        }
+        configurations.swap(next);
+    }
+    return true;
+}
+
+void ParameterSpace::sample(int count, unsigned int seed, std::vector<AnnealingParameters> & configurations) const
+{
+    std::mt19937 generator(seed);
+    configurations.resize(count);
+    for (int c = 0; c < count; c++)
+    {
+        for (std::map<std::string, std::vector<std::string> >::const_iterator it = values.begin(); it != values.end(); ++it)
+        {
+            std::uniform_int_distribution<int> choiceDist(0, static_cast<int>(it->second.size()) - 1);
+            const std::string & value = it->second[choiceDist(generator)];
+
+            std::string low, high;
+            if (!splitRange(value, low, high))
+            {
+                configurations[c].set(it->first, value);
+                continue;
+            }
+
+            // Draw from the range. Integers are rounded
+            double a, b;
+            parseNumber(low, a);
+            parseNumber(high, b);
+            std::uniform_real_distribution<double> rangeDist(std::min(a, b), std::max(a, b));
+            const double x = rangeDist(generator);
+            const bool integer = it->first == "outerLoops" || it->first == "innerLoops" || it->first == "batchSize";
+            std::stringstream text;
+            if (integer)
+            {
+                text << static_cast<long long>(x + 0.5);
+            }
+            else
+            {
+                text << x;
+            }
+            configurations[c].set(it->first, text.str());
+        }
+    }
+}
+
+AnnealingParameters ParameterSpace::first() const
+{
+    AnnealingParameters parameters;
+    for (std::map<std::string, std::vector<std::string> >::const_iterator it = values.begin(); it != values.end(); ++it)
+    {
+        std::string low, high;
+        parameters.set(it->first, splitRange(it->second[0], low, high) ? low : it->second[0]);
+    }
+    return parameters;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Tuner
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns the CPU time of the calling thread in seconds
+ */
+static double threadSeconds()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec + 1e-9 * time.tv_nsec;
+}
+
+void Tuner::evaluate(const std::vector<const TSPInstance*> & instances, const std::vector<AnnealingParameters> & configurations, std::vector<TuningResult> & results) const
+{
+    const int numConfigurations = static_cast<int>(configurations.size());
+    const int numInstances = static_cast<int>(instances.size());
+    const size_t numRuns = static_cast<size_t>(numConfigurations) * numInstances * numSeeds;
+    std::vector<float> lengths(numRuns);
+    std::vector<double> seconds(numRuns);
+
+    for (int c = 0; c < numConfigurations; c++)
+    {
+        for (int i = 0; i < numInstances; i++)
+        {
+            for (int s = 0; s < numSeeds; s++)
+            {
+                pool.submit([this, c, i, s, numInstances, &instances, &configurations, &lengths, &seconds](int) {
+                    // All configurations see the same seeds
+                    ParameterizedOptimizer optimizer(configurations[c]);
+                    optimizer.seed = seed + static_cast<unsigned int>(i * numSeeds + s);
+
+                    const double start = threadSeconds();
+                    std::vector<int> tour;
+                    optimizer.optimize(*instances[i], tour);
+
+                    const size_t k = (static_cast<size_t>(c) * numInstances + i) * numSeeds + s;
+                    seconds[k] = threadSeconds() - start;
+                    lengths[k] = instances[i]->calcTourLength(tour);
+                });
+            }
+        }
+    }
+    pool.wait();
+
+    // The best tour of every instance is the reference
+    std::vector<float> best(numInstances, std::numeric_limits<float>::max());
+    for (size_t k = 0; k < numRuns; k++)
+    {
+        const int i = static_cast<int>(k / numSeeds) % numInstances;
+        best[i] = std::min(best[i], lengths[k]);
+    }
+
+    results.resize(numConfigurations);
+    for (int c = 0; c < numConfigurations; c++)
+    {
+        results[c].parameters = configurations[c];
+        results[c].gap = 0;
+        results[c].seconds = 0;
+        for (int i = 0; i < numInstances; i++)
+        {
+            for (int s = 0; s < numSeeds; s++)
+            {
+                const size_t k = (static_cast<size_t>(c) * numInstances + i) * numSeeds + s;
+                results[c].gap += 100.0 * (lengths[k] / best[i] - 1);
+                results[c].seconds += seconds[k];
+            }
+        }
+        results[c].gap /= numInstances * numSeeds;
+        results[c].seconds /= numInstances * numSeeds;
+    }
+}
+
+void Tuner::paretoFront(const std::vector<TuningResult> & results, std::vector<int> & front)
+{
+    std::vector<int> order(results.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = static_cast<int>(i);
+    }
+    std::sort(order.begin(), order.end(), [&results](int a, int b) {
+        if (results[a].seconds != results[b].seconds)
+        {
+            return results[a].seconds < results[b].seconds;
+        }
+        return results[a].gap < results[b].gap;
+    });
+
+    // Walking from fast to slow, a configuration is on the front if it is
+    // better than all faster ones
+    front.clear();
+    double bestGap = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        if (results[order[i]].gap < bestGap)
+        {
+            bestGap = results[order[i]].gap;
+            front.push_back(order[i]);
+        }
+    }
+}
@@ -0,0 +1,200 @@
+#ifndef TUNER_H
+#define TUNER_H
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tsp.h"
+#include "pool.h"
+
+/**
+ * The parameters of a single annealing configuration
+ */
+class AnnealingParameters {
+public:
+    /**
+     * The bits of the move set
+     */
+    enum {
+        MOVE_REVERSE = 1,
+        MOVE_SWAP = 2,
+        MOVE_ROTATE = 4
+    };
+
+    /**
+     * Constructor. The defaults are the parameters of the GUI
+     */
+    AnnealingParameters() :
+            initialTemp(150),
+            endTemp(1e-2f),
+            alpha(0.95f),
+            outerLoops(100),
+            innerLoops(5000),
+            moves(MOVE_REVERSE | MOVE_SWAP | MOVE_ROTATE),
+            batchSize(0) {}
+
+    /**
+     * The parameters of the geometric cooling schedule
+     */
+    float initialTemp;
+    float endTemp;
+    float alpha;
+    /**
+     * The loop counts
+     */
+    int outerLoops;
+    int innerLoops;
+    /**
+     * The move set as combination of the MOVE_* bits
+     */
+    int moves;
+    /**
+     * The batch size of cold levels. Batching is off by default, because
+     * batched levels only propose chain reversals
+     */
+    int batchSize;
+
+    /**
+     * Sets a parameter from its textual value. Returns false if the name or
+     * the value is invalid
+     */
+    bool set(const std::string & name, const std::string & value);
+
+    /**
+     * Writes the parameters in the format of a parameter space file
+     */
+    void write(std::ostream & out) const;
+
+    /**
+     * Returns the parameters in a single line
+     */
+    std::string toString() const;
+};
+
+/**
+ * An optimizer that owns its moves and cooling schedule and sets them up from
+ * a set of parameters
+ */
+class ParameterizedOptimizer : public Optimizer {
+public:
+    /**
+     * Constructor
+     */
+    ParameterizedOptimizer(const AnnealingParameters & parameters);
+
+private:
+    ParameterizedOptimizer(const ParameterizedOptimizer &);
+    ParameterizedOptimizer & operator=(const ParameterizedOptimizer &);
+
+    /**
+     * The moves
+     */
+    ChainReverseMove reverseMove;
+    SwapCityMove swapMove;
+    RotateCityMove rotateMove;
+    /**
+     * The cooling schedule
+     */
+    GeometricCoolingSchedule schedule;
+};
+
+/**
+ * A space of annealing parameters. It is read from a text file with one line
+ * per parameter: the name followed by the values to try. Numeric parameters
+ * may also be given as range "low:high" for random search. Moves are given as
+ * comma separated list, e.g. "reverse,swap". Parameters that are not listed
+ * keep their default value. Lines starting with # are comments.
+ */
+class ParameterSpace {
+public:
+    /**
+     * Reads a space. Returns false and an error message on invalid input
+     */
+    bool read(std::istream & in, std::string & error);
+
+    /**
+     * Enumerates all combinations of the listed values. Returns false if the
+     * space contains ranges
+     */
+    bool grid(std::vector<AnnealingParameters> & configurations) const;
+
+    /**
+     * Samples count configurations. Every parameter is drawn uniformly from
+     * its values and ranges
+     */
+    void sample(int count, unsigned int seed, std::vector<AnnealingParameters> & configurations) const;
+
+    /**
+     * Returns the configuration made of the first value of every parameter
+     */
+    AnnealingParameters first() const;
+
+private:
+    /**
+     * The listed values of every parameter
+     */
+    std::map<std::string, std::vector<std::string> > values;
+};
+
+/**
+ * The evaluation of a configuration
+ */
+class TuningResult {
+public:
+    /**
+     * The configuration
+     */
+    AnnealingParameters parameters;
+    /**
+     * The mean excess over the best tour any configuration has found on the
+     * same instance in percent
+     */
+    double gap;
+    /**
+     * The mean CPU time of a run in seconds
+     */
+    double seconds;
+};
+
+/**
+ * This class evaluates configurations on a set of instances. Every
+ * configuration runs with the same seeds, and the runs are spread over a
+ * worker pool.
+ */
+class Tuner {
+public:
+    /**
+     * Constructor
+     */
+    Tuner(WorkerPool & pool) : numSeeds(3), seed(1), pool(pool) {}
+
+    /**
+     * The number of runs per configuration and instance
+     */
+    int numSeeds;
+    /**
+     * The first seed
+     */
+    unsigned int seed;
+
+    /**
+     * Runs all configurations on all instances
+     */
+    void evaluate(const std::vector<const TSPInstance*> & instances, const std::vector<AnnealingParameters> & configurations, std::vector<TuningResult> & results) const;
+
+    /**
+     * Computes the configurations that are not dominated in gap and runtime.
+     * The indices are sorted by runtime
+     */
+    static void paretoFront(const std::vector<TuningResult> & results, std::vector<int> & front);
+
+private:
+    /**
+     * The worker pool
+     */
+    WorkerPool & pool;
+};
+
+#endif
@@ -35,26 +35,30 @@ class Matrix
 private:
     T * a;
     int m, n;
+    /// Number of allocated entries
+    size_t capacity;
 
 public:
-    Matrix() : a(0), m(0), n(0)
+    Matrix() : a(0), m(0), n(0), capacity(0)
     {}
 
-    Matrix(int m, int n) : a(0), m(m), n(n)
+    Matrix(int m, int n) : a(0), m(m), n(n), capacity(0)
     {
-        if (n*m) {
-                a = new T[n*m];
+        if (n && m) {
+                capacity = static_cast<size_t>(n)*m;
+                a = new T[capacity];
         }
     }
 
     /// Copy-Konstruktor
-    Matrix(const Matrix& mat) : a(0), m(mat.m), n(mat.n)
+    Matrix(const Matrix& mat) : a(0), m(mat.m), n(mat.n), capacity(0)
     {
-        if (n*m)
+        if (n && m)
         {
-                a = new T[n*m];
+                capacity = static_cast<size_t>(n)*m;
+                a = new T[capacity];
         }
-        std::memcpy(a, mat.a, n*m*sizeof(T));
+        std::memcpy(a, mat.a, static_cast<size_t>(n)*m*sizeof(T));
     }
 
     ~Matrix()
@@ -65,32 +69,43 @@ public:
     T& operator()(int i, int j)
     {
         assert(i>=0 && i<m && j>=0 && j<n);
-        return a[m*j+i];
+        return a[static_cast<size_t>(m)*j+i];
     }
 
     T operator()(int i, int j) const
     {
         assert(i>=0 && i<m && j>=0 && j<n);
-        return a[m*j+i];
+        return a[static_cast<size_t>(m)*j+i];
     }
 
     Matrix& operator=(const Matrix& mat)
     {
-        if (mat.n*mat.m != m*n) {
+        if (static_cast<size_t>(mat.n)*mat.m > capacity) {
                 delete[] a;
-                a = new T[mat.m*mat.n];
+                capacity = static_cast<size_t>(mat.m)*mat.n;
+                a = new T[capacity];
         }
         m = mat.m; n = mat.n;
-        for (int k = 0; k < m*n; k++) {
+        for (size_t k = 0; k < static_cast<size_t>(m)*n; k++) {
                 a[k] = mat.a[k];
         }
         return *this;
     }
 
+    /// Tauscht Eintraege und Dimensionen mit einer anderen Matrix, ohne zu 
+    /// kopieren
+    void swap(Matrix& mat)
+    {
+        std::swap(a, mat.a);
+        std::swap(m, mat.m);
+        std::swap(n, mat.n);
+        std::swap(capacity, mat.capacity);
+    }
+
     /// Alle Eintraege auf Wert v setzen
     Matrix& operator=(T v)
     {
-        for (int k = 0; k < m*n; k++) {
+        for (size_t k = 0; k < static_cast<size_t>(m)*n; k++) {
                 a[k] = v;
         }
         return *this;
@@ -100,7 +115,7 @@ public:
     {
         assert(B.n == n && B.m == m);
 
-        for (int k = 0; k < m*n; k++) {
+        for (size_t k = 0; k < static_cast<size_t>(m)*n; k++) {
             a[k] += B.a[k];
         }
         return *this;
@@ -110,7 +125,7 @@ public:
     {
         assert(B.n == n && B.m == m);
 
-        for (int k = 0; k < m*n; k++) {
+        for (size_t k = 0; k < static_cast<size_t>(m)*n; k++) {
             a[k] -= B.a[k];
         }
         return *this;
@@ -118,7 +133,7 @@ public:
 
     Matrix& operator*=(T v)
     {
-        for (int k = 0; k < m*n; k++) {
+        for (size_t k = 0; k < static_cast<size_t>(m)*n; k++) {
             a[k] *= v;
         }
         return *this;
@@ -126,20 +141,34 @@ public:
 
     Matrix& operator/=(T v)
     {
-        for (int k = 0; k < m*n; k++) {
+        for (size_t k = 0; k < static_cast<size_t>(m)*n; k++) {
             a[k] /= v;
         }
         return *this;
     }
 
+    /// Aendert die Dimensionen. Der Speicher wird nur vergroessert, die 
+    /// Eintraege sind danach undefiniert
     void resize(int mm, int nn)
     {
-        if (m != mm || n != nn) {
+        if (static_cast<size_t>(mm)*nn > capacity) {
             delete[] a;
-            a = new T[mm*nn];
-            m = mm;
-            n = nn;
+            capacity = static_cast<size_t>(mm)*nn;
+            a = new T[capacity];
         }
+        m = mm;
+        n = nn;
+    }
+
+    /// Zeiger auf die Eintraege (spaltenweise gespeichert)
+    T* data()
+    {
+        return a;
+    }
+
+    const T* data() const
+    {
+        return a;
     }
 
     int rows() const